@@ -4,6 +4,7 @@ if(WASM_FOUND)
   message(STATUS "Using WASM clang => " ${WASM_CLANG})
   message(STATUS "Using WASM llc => " ${WASM_LLC})
   message(STATUS "Using WASM llvm-link => " ${WASM_LLVM_LINK})
+  message(STATUS "Using WASM opt => " ${WASM_OPT})
 else()
   message( FATAL_ERROR "No WASM compiler cound be found (make sure WASM_ROOT is set)" )
   return()
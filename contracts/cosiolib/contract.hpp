@@ -8,6 +8,7 @@
 #include <cosiolib/table.hpp>
 #include <cosiolib/singleton.hpp>
 #include <type_traits>
+#include <string.h>
 #include <boost/preprocessor/stringize.hpp>
 #include <boost/preprocessor/seq/for_each.hpp>
 #include <boost/fusion/adapted/std_tuple.hpp>
@@ -27,10 +28,72 @@ namespace cosio {
         name _caller;
     };
     
+    /**
+     * @brief FNV-1a hash of a method name, usable at compile time for dispatching.
+     */
+    constexpr uint32_t method_hash(const char* s, size_t len) {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < len; i++) {
+            h = (h ^ (uint8_t)s[i]) * 16777619u;
+        }
+        return h;
+    }
+    
+    template<size_t N>
+    constexpr uint32_t method_hash(const char (&s)[N]) {
+        return method_hash(s, N - 1);
+    }
+    
+    /**
+     * @brief name of the method being called, read into a fixed buffer without heap allocation.
+     *
+     * Names that don't fit into the buffer fall back to get_contract_method().
+     */
+    class method_name {
+    public:
+        method_name() {
+            int n = ::read_contract_method(_buf, (int)sizeof(_buf));
+            if (n >= 0 && n < (int)sizeof(_buf)) {
+                _data = _buf;
+                _size = n;
+            } else {
+                _long = get_contract_method();
+                _data = _long.data();
+                _size = _long.size();
+            }
+        }
+        
+        method_name(const method_name&) = delete;
+        method_name& operator = (const method_name&) = delete;
+        
+        uint32_t hash() const {
+            return method_hash(_data, _size);
+        }
+        
+        template<size_t N>
+        bool equals(const char (&s)[N]) const {
+            return _size == N - 1 && memcmp(_data, s, _size) == 0;
+        }
+        
+        std::string string() const {
+            return std::string(_data, _size);
+        }
+        
+    private:
+        char _buf[64];
+        std::string _long;
+        const char* _data;
+        size_t _size;
+    };
+    
     template<typename T, typename...Args>
     static void execute_contract_method( T* contract_ptr, void (T::*method)(Args...) ) {
-        auto args = unpack<std::tuple<std::decay_t<Args>...>>( get_contract_args() );
-        auto f = [&]( auto...a ) {
+        // the parameter buffer lives until the method returns, so that string_view and bytes_view
+        // arguments can refer into it. arguments are passed on by reference, methods taking
+        // const references get them without any further copy.
+        bytes params = get_contract_args();
+        auto args = unpack<std::tuple<std::decay_t<Args>...>>( params );
+        auto f = [&]( auto&...a ) {
             (contract_ptr->*method)( a... );
         };
         boost::mp11::tuple_apply( f, args );
@@ -48,21 +111,32 @@ namespace cosio {
 #define COSIO_API_CHECK( r, TYPE, M ) static_assert( cosio::valid_contract_method( &TYPE::M ), \
     BOOST_PP_STRINGIZE(M) ": contract method must return void." );
 
+//
+// methods are dispatched by a switch on the compile-time hash of their names, so that dispatching
+// costs the same for any number of methods. two method names of the same hash won't compile due to
+// duplicated case values.
+//
 #define COSIO_API_CALL( r, TYPE, M ) \
-if ( method == BOOST_PP_STRINGIZE(M) ) { \
-    cosio::execute_contract_method( &this_contract, &TYPE::M ); \
-    return 0; \
-}
+case cosio::method_hash( BOOST_PP_STRINGIZE(M) ): \
+    if ( method.equals( BOOST_PP_STRINGIZE(M) ) ) { \
+        cosio::execute_contract_method( &this_contract, &TYPE::M ); \
+        return 0; \
+    } \
+    break;
 
-#define COSIO_API( TYPE, MEMBERS )  BOOST_PP_SEQ_FOR_EACH( COSIO_API_CALL, TYPE, MEMBERS )
+#define COSIO_API( TYPE, MEMBERS ) \
+switch ( method.hash() ) { \
+    BOOST_PP_SEQ_FOR_EACH( COSIO_API_CALL, TYPE, MEMBERS ) \
+    default: break; \
+}
 
 #define COSIO_ABI( TYPE, MEMBERS ) \
 extern "C" uint32_t COSIO_CONTRACT_ENTRY_NAME () { \
     BOOST_PP_SEQ_FOR_EACH( COSIO_API_CHECK, TYPE, MEMBERS ) \
     TYPE this_contract( cosio::get_contract_name(), cosio::get_contract_caller() ); \
-    auto method = cosio::get_contract_method(); \
+    cosio::method_name method; \
     COSIO_API( TYPE, MEMBERS ) \
-    cosio::cosio_assert(false, std::string("unknown contract method: ") + method); \
+    cosio::cosio_assert(false, std::string("unknown contract method: ") + method.string()); \
     return 1; \
 }
 
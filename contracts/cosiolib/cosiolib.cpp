@@ -1,6 +1,14 @@
 #include <cosiolib/memory.h>
 #include <cosiolib/assert.hpp>
 
+#ifdef COSIO_BUMP_ARENA
+/**
+ *  Size in bytes the arena may grow to before the arena allocator falls back to the general one.
+ *  Weak, so that a contract may define its own value (cosiocc --arena-high-water does that).
+ */
+extern "C" __attribute__((weak)) const uint32_t cosio_arena_high_water = 1024*1024;
+#endif
+
 namespace cosio {
 	
    using ::memset;
@@ -20,155 +28,136 @@ namespace cosio {
    friend void* ::calloc(size_t count, size_t size);
    friend void* ::realloc(void* ptr, size_t size);
    friend void ::free(void* ptr);
+   friend class bump_arena;
    public:
       memory_manager()
       // NOTE: it appears that WASM has an issue with initialization lists if the object is globally allocated,
       //       and seems to just initialize members to 0
-      : _heaps_actual_size(0)
-      , _active_heap(0)
-      , _active_free_heap(0)
+      : _top(nullptr)
+      , _end(nullptr)
       {
       }
 
    private:
-      class memory;
+      // Blocks are carved from a bump region and recycled through one free list per size class.
+      // Size classes are spaced two per power of two (16, 24, 32, 48, 64, 96, ...), so the class of
+      // a size is computed in O(1) and at most a third of a block is slack. Every block starts with
+      // a header holding its class, which makes free() O(1) as well.
 
-      memory* next_active_heap()
+      static uint32_t size_class(uint32_t size)
       {
-         constexpr uint32_t wasm_page_size = 64*1024;
-         memory* const current_memory = _available_heaps + _active_heap;
-
-         const uint32_t current_memory_size = reinterpret_cast<uint32_t>(sbrk(0));
-         if(static_cast<int32_t>(current_memory_size) < 0)
-            return nullptr;
-
-         //grab up to the end of the current WASM memory page provided that it has 1KiB remaining, otherwise
-         // grow to end of next page
-         uint32_t heap_adj;
-         if(current_memory_size % wasm_page_size <= wasm_page_size-1024)
-            heap_adj = (current_memory_size + wasm_page_size) - (current_memory_size % wasm_page_size) - current_memory_size;
-         else
-            heap_adj = (current_memory_size + wasm_page_size*2) - (current_memory_size % (wasm_page_size*2)) - current_memory_size;
-         char* new_memory_start = reinterpret_cast<char*>(sbrk(heap_adj));
-         if(reinterpret_cast<int32_t>(new_memory_start) == -1) {
-            // ensure that any remaining unallocated memory gets cleaned up
-            current_memory->cleanup_remaining();
-            ++_active_heap;
-            _heaps_actual_size = _active_heap;
-            return nullptr;
-         }
+         if (size <= _min_block)
+            return 0;
+         // 2^p < size <= 2^(p+1)
+         const uint32_t p = 31 - __builtin_clz(size - 1);
+         return (size <= (3u << (p - 1))) ? 2 * (p - 4) + 1 : 2 * (p - 3);
+      }
 
-         // if we can expand the current memory, keep working with it
-         if (current_memory->expand_memory(new_memory_start, heap_adj))
-            return current_memory;
+      static uint32_t class_size(uint32_t cls)
+      {
+         return (cls & 1) ? (24u << (cls >> 1)) : (16u << (cls >> 1));
+      }
 
-         // ensure that any remaining unallocated memory gets cleaned up
-         current_memory->cleanup_remaining();
+      static uint32_t& header(char* ptr)
+      {
+         return *reinterpret_cast<uint32_t*>(ptr - _header_size);
+      }
 
-         ++_active_heap;
-         memory* const next = _available_heaps + _active_heap;
-         next->init(new_memory_start, heap_adj);
+      // make room for at least size more bytes at the top of the bump region
+      bool grow(uint32_t size)
+      {
+         if (_top == nullptr)
+         {
+            // see Note on ctor
+            _top = _initial_heap;
+            _end = _initial_heap + _initial_heap_size;
+            if (uint32_t(_end - _top) >= size)
+               return true;
+         }
 
-         return next;
+         constexpr uint32_t wasm_page_size = 64*1024;
+         const uint32_t bytes = (size + wasm_page_size - 1) & ~(wasm_page_size - 1);
+         char* const new_memory = reinterpret_cast<char*>(sbrk(bytes));
+         if (reinterpret_cast<int32_t>(new_memory) == -1)
+            return false;
+
+         // keep the current region if the new memory is contiguous, otherwise its tail is lost
+         if (new_memory != _end)
+            _top = new_memory;
+         _end = new_memory + bytes;
+         return uint32_t(_end - _top) >= size;
       }
 
       void* malloc(uint32_t size)
       {
-         if (size == 0)
+         if (size == 0 || size > _max_block)
             return nullptr;
 
-         // see Note on ctor
-         if (_heaps_actual_size == 0)
-            _heaps_actual_size = _heaps_size;
-
-         adjust_to_mem_block(size);
-
-         // first pass of loop never has to initialize the slot in _available_heap
-         char* buffer = nullptr;
-         memory* current = nullptr;
-         // need to make sure
-         if (_active_heap < _heaps_actual_size)
+         const uint32_t cls = size_class(size);
+         if (_free_lists[cls] != nullptr)
          {
-            memory* const start_heap = &_available_heaps[_active_heap];
-            // only heap 0 won't be initialized already
-            if(_active_heap == 0 && !start_heap->is_init())
-            {
-               start_heap->init(_initial_heap, _initial_heap_size);
-            }
-
-            current = start_heap;
-         }
-
-         while (current != nullptr)
-         {
-            buffer = current->malloc(size);
-            // done if we have a buffer
-            if (buffer != nullptr)
-               break;
-
-            current = next_active_heap();
+            char* const ptr = _free_lists[cls];
+            _free_lists[cls] = *reinterpret_cast<char**>(ptr);
+            return ptr;
          }
 
-         if (buffer == nullptr)
+         const uint32_t block = class_size(cls) + _header_size;
+         if (uint32_t(_end - _top) < block && !grow(block))
          {
-            const uint32_t end_free_heap = _active_free_heap;
-
-            do
+            // out of memory, settle for a free block of a larger class
+            for (uint32_t c = cls + 1; c < _classes; ++c)
             {
-               buffer = _available_heaps[_active_free_heap].malloc_from_freed(size);
-
-               if (buffer != nullptr)
-                  break;
-
-               if (++_active_free_heap == _heaps_actual_size)
-                  _active_free_heap = 0;
-
-            } while (_active_free_heap != end_free_heap);
+               if (_free_lists[c] != nullptr)
+               {
+                  char* const ptr = _free_lists[c];
+                  _free_lists[c] = *reinterpret_cast<char**>(ptr);
+                  return ptr;
+               }
+            }
+            return nullptr;
          }
 
-         return buffer;
+         char* const ptr = _top + _header_size;
+         _top += block;
+         header(ptr) = cls;
+         return ptr;
       }
 
       void* realloc(void* ptr, uint32_t size)
       {
+         if (ptr == nullptr)
+            return malloc(size);
+
          if (size == 0)
          {
             free(ptr);
             return nullptr;
          }
 
-         adjust_to_mem_block(size);
+         char* const char_ptr = static_cast<char*>(ptr);
+         const uint32_t cls = header(char_ptr);
+         const uint32_t capacity = class_size(cls);
+         if (size <= capacity)
+            return ptr;
+         if (size > _max_block)
+            return nullptr;
 
-         char* realloc_ptr = nullptr;
-         uint32_t orig_ptr_size = 0;
-         if (ptr != nullptr)
+         // the most recent block grows in place, which covers buffers repeatedly growing at the top
+         const uint32_t new_cls = size_class(size);
+         const uint32_t extra = class_size(new_cls) - capacity;
+         if (char_ptr + capacity == _top && (uint32_t(_end - _top) >= extra || (grow(extra) && char_ptr + capacity == _top)))
          {
-            char* const char_ptr = static_cast<char*>(ptr);
-            for (memory* realloc_heap = _available_heaps; realloc_heap < _available_heaps + _heaps_actual_size && realloc_heap->is_init(); ++realloc_heap)
-            {
-               if (realloc_heap->is_in_heap(char_ptr))
-               {
-                  realloc_ptr = realloc_heap->realloc_in_place(char_ptr, size, &orig_ptr_size);
-
-                  if (realloc_ptr != nullptr)
-                     return realloc_ptr;
-                  else
-                     break;
-               }
-            }
+            _top += extra;
+            header(char_ptr) = new_cls;
+            return ptr;
          }
 
-         char* new_alloc = static_cast<char*>(malloc(size));
+         char* const new_alloc = static_cast<char*>(malloc(size));
          if (new_alloc == nullptr)
             return nullptr;
 
-         const uint32_t copy_size = (size < orig_ptr_size) ? size : orig_ptr_size;
-         if (copy_size > 0)
-         {
-            memcpy(new_alloc, ptr, copy_size);
-            free (ptr);
-         }
-
+         memcpy(new_alloc, ptr, capacity);
+         free(ptr);
          return new_alloc;
       }
 
@@ -178,308 +167,160 @@ namespace cosio {
             return;
 
          char* const char_ptr = static_cast<char*>(ptr);
-         for (memory* free_heap = _available_heaps; free_heap < _available_heaps + _heaps_actual_size && free_heap->is_init(); ++free_heap)
-         {
-            if (free_heap->is_in_heap(char_ptr))
-            {
-               free_heap->free(char_ptr);
-               break;
-            }
-         }
+         const uint32_t cls = header(char_ptr);
+         *reinterpret_cast<char**>(char_ptr) = _free_lists[cls];
+         _free_lists[cls] = char_ptr;
       }
 
-      void adjust_to_mem_block(uint32_t& size)
+      // the header is 8 bytes to keep blocks 8-byte aligned, all class sizes being multiples of 8
+      static const uint32_t _header_size = 8;
+      static const uint32_t _min_block = 16;
+      static const uint32_t _max_block = uint32_t(1) << 30;
+      static const uint32_t _classes = 54;
+      static const uint32_t _initial_heap_size = 8192;
+      alignas(8) char _initial_heap[_initial_heap_size];
+      char* _free_lists[_classes];
+      char* _top;
+      char* _end;
+   };
+
+   memory_manager memory_heap;
+
+#ifdef COSIO_BUMP_ARENA
+
+   /**
+    *  Allocator of the arena mode, see cosiolib_arena.cpp.
+    *
+    *  Memory of a contract call is discarded when the call returns, so this allocator only bumps a
+    *  pointer over memory obtained from sbrk and free() does nothing. Once the arena would grow past
+    *  cosio_arena_high_water bytes, allocations go to memory_heap instead, so that calls allocating
+    *  a lot don't run out of memory.
+    */
+   class bump_arena  // NOTE: Should never allocate another instance of bump_arena
+   {
+   friend void* ::malloc(size_t size);
+   friend void* ::calloc(size_t count, size_t size);
+   friend void* ::realloc(void* ptr, size_t size);
+   friend void ::free(void* ptr);
+   public:
+      bump_arena()
+      // see Note on memory_manager ctor
+      : _start(nullptr)
+      , _top(nullptr)
+      , _end(nullptr)
+      , _exhausted(false)
       {
-         const uint32_t remainder = (size + _size_marker) & _rem_mem_block_mask;
-         if (remainder > 0)
-         {
-            size += _mem_block - remainder;
-         }
       }
 
-      class memory
+   private:
+      static uint32_t& block_size(char* ptr)
       {
-      public:
-         memory()
-         : _heap_size(0)
-         , _heap(nullptr)
-         , _offset(0)
-         {
-         }
+         return *reinterpret_cast<uint32_t*>(ptr - _header_size);
+      }
 
-         void init(char* const mem_heap, uint32_t size)
-         {
-            _heap_size = size;
-            _heap = mem_heap;
-         }
+      bool in_arena(const char* ptr) const
+      {
+         return ptr >= _start && ptr < _top;
+      }
 
-         uint32_t is_init() const
-         {
-            return _heap != nullptr;
-         }
+      // make room for at least size more bytes at the top of the arena
+      bool grow(uint32_t size)
+      {
+         if (_exhausted)
+            return false;
 
-         uint32_t is_in_heap(const char* const ptr) const
+         if (uint32_t(_top - _start) + size > cosio_arena_high_water)
          {
-            const char* const end_of_buffer = _heap + _heap_size;
-            const char* const first_ptr_of_buffer = _heap + _size_marker;
-            return ptr >= first_ptr_of_buffer && ptr < end_of_buffer;
+            _exhausted = true;
+            return false;
          }
 
-         uint32_t is_capacity_remaining() const
+         constexpr uint32_t wasm_page_size = 64*1024;
+         const uint32_t bytes = (size + wasm_page_size - 1) & ~(wasm_page_size - 1);
+         char* const new_memory = reinterpret_cast<char*>(sbrk(bytes));
+         if (reinterpret_cast<int32_t>(new_memory) == -1)
          {
-            return _offset + _size_marker < _heap_size;
+            _exhausted = true;
+            return false;
          }
 
-         char* malloc(uint32_t size)
+         if (_start == nullptr)
          {
-            uint32_t used_up_size = _offset + size + _size_marker;
-            if (used_up_size > _heap_size)
-            {
-               return nullptr;
-            }
-
-            buffer_ptr new_buff(&_heap[_offset + _size_marker], size, _heap + _heap_size);
-            _offset += size + _size_marker;
-            new_buff.mark_alloc();
-            return new_buff.ptr();
+            _start = _top = new_memory;
          }
-
-         char* malloc_from_freed(uint32_t size)
+         else if (new_memory != _end)
          {
-            cosio_assert(_offset == _heap_size, "malloc_from_freed was designed to only be called after _heap was completely allocated");
-
-            char* current = _heap + _size_marker;
-            while (current != nullptr)
-            {
-               buffer_ptr current_buffer(current, _heap + _heap_size);
-               if (!current_buffer.is_alloc())
-               {
-                  // done if we have enough contiguous memory
-                  if (current_buffer.merge_contiguous(size))
-                  {
-                     current_buffer.mark_alloc();
-                     return current;
-                  }
-               }
-
-               current = current_buffer.next_ptr();
-            }
-
-            // failed to find any free memory
-            return nullptr;
+            // the arena must stay contiguous for in_arena() to work
+            _exhausted = true;
+            return false;
          }
+         _end = new_memory + bytes;
+         return true;
+      }
 
-         char* realloc_in_place(char* const ptr, uint32_t size, uint32_t* orig_ptr_size)
-         {
-            const char* const end_of_buffer = _heap + _heap_size;
-
-            buffer_ptr orig_buffer(ptr, end_of_buffer);
-            *orig_ptr_size = orig_buffer.size();
-            // is the passed in pointer valid
-            char* const orig_buffer_end = orig_buffer.end();
-            if (orig_buffer_end > end_of_buffer)
-            {
-               *orig_ptr_size = 0;
-               return nullptr;
-            }
+      void* malloc(uint32_t size)
+      {
+         if (size == 0)
+            return nullptr;
 
-            if (ptr > end_of_buffer - size)
-            {
-               // cannot resize in place
-               return nullptr;
-            }
+         const uint32_t block = ((size + 7) & ~7u) + _header_size;
+         if (uint32_t(_end - _top) < block && !grow(block))
+            return memory_heap.malloc(size);
 
-            if( *orig_ptr_size > size )
-            {
-               // use a buffer_ptr to allocate the memory to free
-               char* const new_ptr = ptr + size + _size_marker;
-               buffer_ptr excess_to_free(new_ptr, *orig_ptr_size - size, _heap + _heap_size);
-               excess_to_free.mark_free();
+         char* const ptr = _top + _header_size;
+         _top += block;
+         block_size(ptr) = block - _header_size;
+         return ptr;
+      }
 
-               return ptr;
-            }
-            // if ptr was the last allocated buffer, we can expand
-            else if (orig_buffer_end == &_heap[_offset])
-            {
-               orig_buffer.size(size);
-               _offset += size - *orig_ptr_size;
+      void* realloc(void* ptr, uint32_t size)
+      {
+         if (ptr == nullptr)
+            return malloc(size);
 
-               return ptr;
-            }
-            if (size == *orig_ptr_size )
-               return ptr;
+         char* const char_ptr = static_cast<char*>(ptr);
+         if (!in_arena(char_ptr))
+            return memory_heap.realloc(ptr, size);
 
-            if (!orig_buffer.merge_contiguous_if_available(size))
-               // could not resize in place
-               return nullptr;
+         if (size == 0)
+            return nullptr;
 
-            orig_buffer.mark_alloc();
+         const uint32_t capacity = block_size(char_ptr);
+         if (size <= capacity)
             return ptr;
-         }
 
-         void free(char* ptr)
+         // the most recent allocation grows in place
+         const uint32_t extra = ((size + 7) & ~7u) - capacity;
+         if (char_ptr + capacity == _top && (uint32_t(_end - _top) >= extra || grow(extra)))
          {
-            buffer_ptr to_free(ptr, _heap + _heap_size);
-            to_free.mark_free();
-         }
-
-         void cleanup_remaining()
-         {
-            if (_offset == _heap_size)
-               return;
-
-            // take the remaining memory and act like it was allocated
-            const uint32_t size = _heap_size - _offset - _size_marker;
-            buffer_ptr new_buff(&_heap[_offset + _size_marker], size, _heap + _heap_size);
-            _offset = _heap_size;
-            new_buff.mark_free();
-         }
-
-         bool expand_memory(char* exp_mem, uint32_t size)
-         {
-            if (_heap + _heap_size != exp_mem)
-               return false;
-
-            _heap_size += size;
-
-            return true;
+            _top += extra;
+            block_size(char_ptr) = capacity + extra;
+            return ptr;
          }
 
-      private:
-         class buffer_ptr
-         {
-         public:
-            buffer_ptr(void* ptr, const char* const heap_end)
-            : _ptr(static_cast<char*>(ptr))
-            , _size(*reinterpret_cast<uint32_t*>(static_cast<char*>(ptr) - _size_marker) & ~_alloc_memory_mask)
-            , _heap_end(heap_end)
-            {
-            }
-
-            buffer_ptr(void* ptr, uint32_t buff_size, const char* const heap_end)
-            : _ptr(static_cast<char*>(ptr))
-            , _heap_end(heap_end)
-            {
-               size(buff_size);
-            }
-
-            uint32_t size() const
-            {
-               return _size;
-            }
-
-            char* next_ptr() const
-            {
-               char* const next = end() + _size_marker;
-               if (next >= _heap_end)
-                  return nullptr;
-
-               return next;
-            }
-
-            void size(uint32_t val)
-            {
-               // keep the same state (allocated or free) as was set before
-               const uint32_t memory_state = *reinterpret_cast<uint32_t*>(_ptr - _size_marker) & _alloc_memory_mask;
-               *reinterpret_cast<uint32_t*>(_ptr - _size_marker) = val | memory_state;
-               _size = val;
-            }
-
-            char* end() const
-            {
-               return _ptr + _size;
-            }
-
-            char* ptr() const
-            {
-               return _ptr;
-            }
-
-            void mark_alloc()
-            {
-               *reinterpret_cast<uint32_t*>(_ptr - _size_marker) |= _alloc_memory_mask;
-            }
-
-            void mark_free()
-            {
-               *reinterpret_cast<uint32_t*>(_ptr - _size_marker) &= ~_alloc_memory_mask;
-            }
-
-            bool is_alloc() const
-            {
-               return *reinterpret_cast<const uint32_t*>(_ptr - _size_marker) & _alloc_memory_mask;
-            }
-
-            bool merge_contiguous_if_available(uint32_t needed_size)
-            {
-               return merge_contiguous(needed_size, true);
-            }
-
-            bool merge_contiguous(uint32_t needed_size)
-            {
-               return merge_contiguous(needed_size, false);
-            }
-         private:
-            bool merge_contiguous(uint32_t needed_size, bool all_or_nothing)
-            {
-               // do not bother if there isn't contiguious space to allocate
-               if( all_or_nothing && uint32_t(_heap_end - _ptr) < needed_size )
-                  return false;
-
-               uint32_t possible_size = _size;
-               while (possible_size < needed_size  && (_ptr + possible_size < _heap_end))
-               {
-                  const uint32_t next_mem_flag_size = *reinterpret_cast<const uint32_t*>(_ptr + possible_size);
-                  // if ALLOCed then done with contiguous free memory
-                  if (next_mem_flag_size & _alloc_memory_mask)
-                     break;
-
-                  possible_size += (next_mem_flag_size & ~_alloc_memory_mask) + _size_marker;
-               }
-
-               if (all_or_nothing && possible_size < needed_size)
-                  return false;
-
-               // combine
-               const uint32_t new_size = possible_size < needed_size ? possible_size : needed_size;
-               size(new_size);
-
-               if (possible_size > needed_size)
-               {
-                  const uint32_t freed_size = possible_size - needed_size - _size_marker;
-                  buffer_ptr freed_remainder(_ptr + needed_size + _size_marker, freed_size, _heap_end);
-                  freed_remainder.mark_free();
-               }
+         char* const new_alloc = static_cast<char*>(malloc(size));
+         if (new_alloc != nullptr)
+            memcpy(new_alloc, ptr, capacity);
+         return new_alloc;
+      }
 
-               return new_size == needed_size;
-            }
+      void free(void* ptr)
+      {
+         char* const char_ptr = static_cast<char*>(ptr);
+         if (ptr != nullptr && !in_arena(char_ptr))
+            memory_heap.free(ptr);
+      }
 
-            char* _ptr;
-            uint32_t _size;
-            const char* const _heap_end;
-         };
-
-         uint32_t _heap_size;
-         char* _heap;
-         uint32_t _offset;
-      };
-
-      static const uint32_t _size_marker = sizeof(uint32_t);
-      // allocate memory in 8 char blocks
-      static const uint32_t _mem_block = 8;
-      static const uint32_t _rem_mem_block_mask = _mem_block - 1;
-      static const uint32_t _initial_heap_size = 8192;//32768;
-      // if sbrk is not called outside of this file, then this is the max times we can call it
-      static const uint32_t _heaps_size = 16;
-      char _initial_heap[_initial_heap_size];
-      memory _available_heaps[_heaps_size];
-      uint32_t _heaps_actual_size;
-      uint32_t _active_heap;
-      uint32_t _active_free_heap;
-      static const uint32_t _alloc_memory_mask = uint32_t(1) << 31;
+      static const uint32_t _header_size = 8;
+      char* _start;
+      char* _top;
+      char* _end;
+      bool _exhausted;
    };
 
-   memory_manager memory_heap;
+   bump_arena arena_heap;
+
+#endif
 
 } /// namespace cosio
 
@@ -523,26 +364,33 @@ void* sbrk(size_t num_bytes) {
       return reinterpret_cast<void*>(prev_num_bytes);
 }
 
+#ifdef COSIO_BUMP_ARENA
+#define COSIO_HEAP cosio::arena_heap
+#else
+#define COSIO_HEAP cosio::memory_heap
+#endif
+
 void* malloc(size_t size)
 {
-   return cosio::memory_heap.malloc(size);
+   return COSIO_HEAP.malloc(size);
 }
 
 void* calloc(size_t count, size_t size)
 {
-   void* ptr = cosio::memory_heap.malloc(count*size);
-   memset(ptr, 0, count*size);
+   void* ptr = COSIO_HEAP.malloc(count*size);
+   if (ptr != nullptr)
+      memset(ptr, 0, count*size);
    return ptr;
 }
 
 void* realloc(void* ptr, size_t size)
 {
-   return cosio::memory_heap.realloc(ptr, size);
+   return COSIO_HEAP.realloc(ptr, size);
 }
 
 void free(void* ptr)
 {
-   return cosio::memory_heap.free(ptr);
+   return COSIO_HEAP.free(ptr);
 }
 
 }
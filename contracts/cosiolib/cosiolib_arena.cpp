@@ -0,0 +1,3 @@
+// cosiolib with the per-call bump arena allocator, linked instead of cosiolib by cosiocc --arena.
+#define COSIO_BUMP_ARENA
+#include "cosiolib.cpp"
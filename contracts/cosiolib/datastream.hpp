@@ -185,12 +185,32 @@ DataStream& operator << ( DataStream& ds, const std::string& v ) {
 
 template<typename DataStream>
 DataStream& operator >> ( DataStream& ds, std::string& v ) {
-   std::vector<char> tmp;
-   ds >> tmp;
-   if( tmp.size() )
-      v = std::string(tmp.data(),tmp.data()+tmp.size());
-   else
-      v = std::string();
+   unsigned_int s;
+   ds >> s;
+   cosio_assert( ds.remaining() >= s.value, "read" );
+   v.resize( s.value );
+   if( s.value )
+      ds.read( &v[0], s.value );
+   return ds;
+}
+
+template<typename DataStream>
+DataStream& operator << ( DataStream& ds, const cosio::string_view& v ) {
+   ds << unsigned_int( v.size() );
+   if (v.size())
+      ds.write(v.data(), v.size());
+   return ds;
+}
+
+/**
+ *  Deserialize a string_view referring into the stream buffer, without copying
+ */
+inline datastream<const char*>& operator >> ( datastream<const char*>& ds, cosio::string_view& v ) {
+   unsigned_int s;
+   ds >> s;
+   cosio_assert( ds.remaining() >= s.value, "read" );
+   v = cosio::string_view( ds.pos(), s.value );
+   ds.skip( s.value );
    return ds;
 }
 
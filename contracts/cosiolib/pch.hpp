@@ -0,0 +1,12 @@
+#pragma once
+
+//
+// The headers every contract includes, precompiled once by cosiocc. A source whose first line
+// of code includes one of them gets all of them included ahead of it instead.
+//
+// Only headers whose meaning does not depend on macros a contract may define belong here.
+//
+
+#include <cosiolib/contract.hpp>
+#include <cosiolib/print.hpp>
+#include <cosiolib/system.hpp>
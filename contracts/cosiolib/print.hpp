@@ -55,24 +55,36 @@ namespace cosio {
         ::print_uint(n);
     }
     
-    template <typename = std::enable_if_t< !std::is_same<int, int64_t>::value
-                                        && !std::is_same<int, int32_t>::value
-                                        && !std::is_same<int, int16_t>::value
-                                        && !std::is_same<int, int8_t>::value
+    // dependent conditions, so that the overloads below are dropped, not rejected, where their
+    // parameter type is one of the types above.
+    template <typename Int = int, typename = std::enable_if_t< !std::is_same<Int, int64_t>::value
+                                        && !std::is_same<Int, int32_t>::value
+                                        && !std::is_same<Int, int16_t>::value
+                                        && !std::is_same<Int, int8_t>::value
     > >
     inline void print(int n) {
         ::print_int(n);
     }
     
-    template <typename = std::enable_if_t< !std::is_same<unsigned int, uint64_t>::value
-                                        && !std::is_same<unsigned int, uint32_t>::value
-                                        && !std::is_same<unsigned int, uint16_t>::value
-                                        && !std::is_same<unsigned int, uint8_t>::value
+    template <typename UInt = unsigned int, typename = std::enable_if_t< !std::is_same<UInt, uint64_t>::value
+                                        && !std::is_same<UInt, uint32_t>::value
+                                        && !std::is_same<UInt, uint16_t>::value
+                                        && !std::is_same<UInt, uint8_t>::value
     > >
     inline void print(unsigned int n) {
         ::print_uint(n);
     }
     
+    template <typename LongLong = long long, typename = std::enable_if_t< !std::is_same<LongLong, int64_t>::value > >
+    inline void print(long long n) {
+        ::print_int(n);
+    }
+    
+    template <typename ULongLong = unsigned long long, typename = std::enable_if_t< !std::is_same<ULongLong, uint64_t>::value > >
+    inline void print(unsigned long long n) {
+        ::print_uint(n);
+    }
+    
     inline void print(bool b) {
         print(b? "true" : "false");
     }
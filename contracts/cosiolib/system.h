@@ -169,10 +169,14 @@ extern "C" {
      */
     void cos_assert(int pred, char* msg, int msg_len);
     
+#ifndef COSIO_NATIVE
     /**
      Abort execution of contract.
+     @remarks
+     Contracts built for the host (cosiocc --native) use abort() of the host C library instead.
      */
     void abort();
+#endif
     
     /**
      Get parameters data of current contract.
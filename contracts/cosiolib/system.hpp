@@ -4,6 +4,9 @@
 #include <cosiolib/types.hpp>
 #include <cosiolib/assert.hpp>
 #include <cosiolib/datastream.hpp>
+#ifdef COSIO_NATIVE
+#include <exception>
+#endif
 
 namespace cosio {
     
@@ -15,13 +18,75 @@ namespace cosio {
         return ::current_timestamp();
     }
     
+    /**
+     * @brief reads variable-length host data with a single call in the common case.
+     *
+     * Host readers take a buffer and its capacity. Instead of asking for the size first, data is
+     * read into a reusable scratch buffer, and only if the buffer gets filled up, which may mean
+     * that data was truncated, the size is queried and data read again. The buffer grows to fit
+     * the largest data seen, up to max_capacity.
+     */
+    class scratch_reader {
+    public:
+        static constexpr int initial_capacity = 256;
+        static constexpr int max_capacity = 16 * 1024;
+        
+        struct stats {
+            uint32_t fits = 0;          ///< number of reads done with a single host call
+            uint32_t overflows = 0;     ///< number of reads which needed extra host calls
+        };
+        
+        template<typename Reader>
+        static void read(bytes& result, Reader reader) {
+            auto& self = instance();
+            auto& buf = self._buffer;
+            int capacity = (int)buf.size();
+            int n = reader(buf.data(), capacity);
+            if (n < capacity) {
+                self._stats.fits++;
+                result.assign(buf.begin(), buf.begin() + (n > 0? n : 0));
+                return;
+            }
+            self._stats.overflows++;
+            int size = reader(nullptr, 0);
+            if (size <= capacity) {
+                result.assign(buf.begin(), buf.begin() + (size > 0? size : 0));
+            } else {
+                result.resize(size);
+                reader(result.data(), size);
+            }
+            self.grow(size);
+        }
+        
+        static const stats& get_stats() {
+            return instance()._stats;
+        }
+        
+    private:
+        scratch_reader(): _buffer(initial_capacity) { }
+        
+        static scratch_reader& instance() {
+            static scratch_reader r;
+            return r;
+        }
+        
+        void grow(int size) {
+            int capacity = (int)_buffer.size();
+            while (capacity <= size && capacity < max_capacity) {
+                capacity *= 2;
+            }
+            if (capacity > (int)_buffer.size()) {
+                _buffer.resize(capacity);
+            }
+        }
+        
+        bytes _buffer;
+        stats _stats;
+    };
+    
     inline bytes _read_bytes( int(*reader)(char*,int) ) {
         bytes result;
-        int min_size = reader(nullptr, 0);
-        if (min_size > 0) {
-            result.resize(min_size);
-            reader((char*)result.data(), min_size);
-        }
+        scratch_reader::read(result, reader);
         return result;
     }
     
@@ -131,8 +196,92 @@ namespace cosio {
         return to.is_contract()? transfer_to_contract(to, amount, memo) : transfer_to_user(to, amount, memo);
     }
     
+#ifdef COSIO_NATIVE
+    // natively, host aborts are exceptions, which may come out of destructors writing to the host.
+    #define COSIO_HOST_DTOR noexcept(false)
+#else
+    #define COSIO_HOST_DTOR
+#endif
+    
+    /**
+     * @brief base class of caches that hold back host writes until the end of a contract invocation.
+     *
+     * Live caches are linked together so that all of them can be flushed before control
+     * leaves the contract, e.g. on a cross-contract call that may read our tables.
+     */
+    class write_back_cache {
+    public:
+        write_back_cache(): _prev(nullptr), _next(head()) {
+            if (_next) {
+                _next->_prev = this;
+            }
+            head() = this;
+        }
+        
+        write_back_cache(const write_back_cache&) = delete;
+        write_back_cache& operator = (const write_back_cache&) = delete;
+        
+        virtual ~write_back_cache() COSIO_HOST_DTOR {
+            if (_prev) {
+                _prev->_next = _next;
+            } else {
+                head() = _next;
+            }
+            if (_next) {
+                _next->_prev = _prev;
+            }
+        }
+        
+        virtual void flush() = 0;
+        
+        /**
+         * @brief drop everything cached, so that the next access reads from the host again.
+         *
+         * Only call it after flush(), or unflushed changes are lost.
+         */
+        virtual void invalidate() = 0;
+        
+        /**
+         * @brief whether the contract is aborting, in which case nothing should be written back.
+         *
+         * Contracts only see this happen in native builds, where aborts are exceptions that unwind.
+         */
+        static bool aborting() {
+#ifdef COSIO_NATIVE
+            return std::uncaught_exception();
+#else
+            return false;
+#endif
+        }
+        
+        static void flush_all() {
+            for (auto c = head(); c; c = c->_next) {
+                c->flush();
+            }
+        }
+        
+        static void invalidate_all() {
+            for (auto c = head(); c; c = c->_next) {
+                c->invalidate();
+            }
+        }
+        
+    private:
+        static write_back_cache*& head() {
+            static write_back_cache* h = nullptr;
+            return h;
+        }
+        
+        write_back_cache* _prev;
+        write_back_cache* _next;
+    };
+    
     inline void execute_contract(const name& contract, const std::string& method, const bytes& params, coin_amount coins) {
         cosio_assert(contract.is_contract(), "invalid contract name: " + contract.string());
+        // the callee may call back into this contract and change its tables, so cached rows are
+        // written back, and dropped to be read again afterwards.
+        write_back_cache::flush_all();
+        write_back_cache::invalidate_all();
         std::string owner = contract.account();
         std::string name = contract.contract();
         return ::contract_call(
@@ -5,6 +5,7 @@
 #include <boost/preprocessor/stringize.hpp>
 #include <cosiolib/types.hpp>
 #include <cosiolib/system.hpp>
+#include <map>
 
 namespace cosio {
     
@@ -16,16 +17,11 @@ namespace cosio {
     }
     
     inline void table_get(const std::string& table_name, const bytes& primary_key, bytes& record) {
-        int size = ::table_get_record((char*)table_name.c_str(), (int)table_name.size(),
+        scratch_reader::read(record, [&](char* buf, int size) {
+            return ::table_get_record((char*)table_name.c_str(), (int)table_name.size(),
                                       (char*)primary_key.data(), (int)primary_key.size(),
-                                      nullptr, 0);
-        record.clear();
-        if(size > 0) {
-            record.resize(size);
-            ::table_get_record((char*)table_name.c_str(), (int)table_name.size(),
-                               (char*)primary_key.data(), (int)primary_key.size(),
-                               (char*)record.data(), size);
-        }
+                                      buf, size);
+        });
     }
     
     inline void table_insert(const std::string& table_name, const bytes& record) {
@@ -101,6 +97,134 @@ namespace cosio {
         }
     };
 
+    /**
+     * @brief a table with a per-invocation write-back record cache.
+     *
+     * Records are cached by packed primary key, so repeated has/get/get_or_default calls on the
+     * same key cost a single host read. Inserts, updates and removals only change the cache; the
+     * resulting rows are written to the host once, when the table is destroyed at the end of
+     * apply(), when flush() is called, or before a cross-contract call. A cross-contract call also
+     * empties the cache, since the callee may call back and change the table.
+     *
+     * Reads through table_get_ex() of the same table from within this invocation see the host
+     * state, not unflushed changes.
+     */
+    template<typename Record, typename Primary, typename NameProvider, Primary Record::*Key>
+    class cached_table : public write_back_cache {
+    public:
+        static const char* name() {
+            return NameProvider::name();
+        }
+        
+        ~cached_table() COSIO_HOST_DTOR {
+            if (!aborting()) {
+                flush();
+            }
+        }
+        
+        bool has(const Primary& key) {
+            return lookup(pack(key)).exists;
+        }
+        
+        Record get(const Primary& key) {
+            auto& e = lookup(pack(key));
+            cosio_assert(e.exists, std::string("record not found in table ") + name());
+            return e.record;
+        }
+        
+        Record get_or_default(const Primary& key, const Record& def = Record()) {
+            auto& e = lookup(pack(key));
+            return e.exists? e.record : def;
+        }
+        
+        Record get_or_create(const Primary& key, const Record& def = Record()) {
+            auto& e = lookup(pack(key));
+            if (!e.exists) {
+                insert([&](Record& r) {
+                    r = def;
+                });
+                return def;
+            }
+            return e.record;
+        }
+        
+        template<typename Modifier>
+        void insert(Modifier m) {
+            Record r;
+            m(r);
+            // a key never seen before is not looked up, the host rejects duplicates at flush time.
+            auto& e = _records[pack(r.*Key)];
+            cosio_assert(!e.exists, std::string("duplicated primary key in table ") + name());
+            e.record = r;
+            e.exists = true;
+            e.dirty = true;
+        }
+        
+        template<typename Modifier>
+        void update(const Primary& key, Modifier m) {
+            auto& e = lookup(pack(key));
+            cosio_assert(e.exists, std::string("record not found in table ") + name());
+            m(e.record);
+            e.dirty = true;
+        }
+        
+        void remove(const Primary& key) {
+            auto& e = lookup(pack(key));
+            cosio_assert(e.exists, std::string("record not found in table ") + name());
+            e.exists = false;
+            e.dirty = true;
+        }
+        
+        void flush() override {
+            for (auto& kv : _records) {
+                auto& e = kv.second;
+                if (!e.dirty) {
+                    continue;
+                }
+                if (e.exists) {
+                    if (e.in_host) {
+                        table_update(name(), kv.first, pack(e.record));
+                    } else {
+                        table_insert(name(), pack(e.record));
+                    }
+                } else if (e.in_host) {
+                    table_delete(name(), kv.first);
+                }
+                e.in_host = e.exists;
+                e.dirty = false;
+            }
+        }
+        
+        void invalidate() override {
+            _records.clear();
+        }
+        
+    private:
+        struct entry {
+            Record record;
+            bool exists = false;        ///< whether the record exists as seen by this invocation
+            bool in_host = false;       ///< whether the record exists in host database
+            bool dirty = false;         ///< whether the record must be written back
+        };
+        
+        entry& lookup(const bytes& key) {
+            auto it = _records.find(key);
+            if (it != _records.end()) {
+                return it->second;
+            }
+            auto& e = _records[key];
+            bytes enc;
+            table_get(name(), key, enc);
+            if (!enc.empty()) {
+                e.record = unpack<Record>(enc);
+                e.exists = e.in_host = true;
+            }
+            return e;
+        }
+        
+        std::map<bytes, entry> _records;
+    };
+
     inline bool table_has_ex(const name& contract_name, const std::string& table_name, const bytes& primary_key) {
         if (!contract_name.is_contract()) {
             return false;
@@ -118,20 +242,13 @@ namespace cosio {
     inline void table_get_ex(const name& contract_name, const std::string& table_name, const bytes& primary_key, bytes& record) {
         std::string owner = contract_name.account();
         std::string contract = contract_name.contract();
-        int size = ::table_get_record_ex((char*)owner.c_str(), (int)owner.size(),
+        scratch_reader::read(record, [&](char* buf, int size) {
+            return ::table_get_record_ex((char*)owner.c_str(), (int)owner.size(),
                                          (char*)contract.c_str(), (int)contract.size(),
                                          (char*)table_name.c_str(), (int)table_name.size(),
                                          (char*)primary_key.data(), (int)primary_key.size(),
-                                         nullptr, 0);
-        record.clear();
-        if(size > 0) {
-            record.resize(size);
-            ::table_get_record_ex((char*)owner.c_str(), (int)owner.size(),
-                                  (char*)contract.c_str(), (int)contract.size(),
-                                  (char*)table_name.c_str(), (int)table_name.size(),
-                                  (char*)primary_key.data(), (int)primary_key.size(),
-                                  (char*)record.data(), size);
-        }
+                                         buf, size);
+        });
     }
 
     template<typename Record, typename Primary>
@@ -182,7 +299,7 @@ namespace cosio {
 //
 #define _COSIO_MEMBER_TYPE(m) decltype(cosio::get_member_type(m))
 
-#define _COSIO_TABLE(RECORD, INDICES, NAME) cosio::table<RECORD, _COSIO_MEMBER_TYPE(&(RECORD::BOOST_PP_SEQ_ELEM(0, INDICES))), NAME>
+#define _COSIO_TABLE(RECORD, INDICES, NAME) cosio::table<RECORD, _COSIO_MEMBER_TYPE(&RECORD::BOOST_PP_SEQ_ELEM(0, INDICES)), NAME>
 
 #define _COSIO_NAME_PROVIDER(TYPENAME, NAME) struct TYPENAME { static const char *name() { return NAME; } }
 
@@ -197,10 +314,26 @@ _COSIO_NAMED_TABLE(BOOST_PP_SEQ_CAT((__cosio_name)(__COUNTER__)), NAME, RECORD,
 
 #define COSIO_DEFINE_NAMED_TABLE(VARNAME, NAME, RECORD, INDICES)  COSIO_NAMED_TABLE(NAME, RECORD, INDICES) VARNAME
 
+//
+// macros for local table definition with a write-back record cache
+//
+#define _COSIO_CACHED_TABLE(RECORD, INDICES, NAME) cosio::cached_table<RECORD, _COSIO_MEMBER_TYPE(&RECORD::BOOST_PP_SEQ_ELEM(0, INDICES)), NAME, &RECORD::BOOST_PP_SEQ_ELEM(0, INDICES)>
+
+#define _COSIO_NAMED_CACHED_TABLE(NAMETYPE, NAME, RECORD, INDICES) \
+_COSIO_NAME_PROVIDER(NAMETYPE, NAME);\
+_COSIO_CACHED_TABLE(RECORD, INDICES, NAMETYPE)
+
+#define COSIO_NAMED_CACHED_TABLE(NAME, RECORD, INDICES) \
+_COSIO_NAMED_CACHED_TABLE(BOOST_PP_SEQ_CAT((__cosio_name)(__COUNTER__)), NAME, RECORD, INDICES)
+
+#define COSIO_DEFINE_CACHED_TABLE(VARNAME, RECORD, INDICES)  COSIO_NAMED_CACHED_TABLE(BOOST_PP_STRINGIZE(VARNAME), RECORD, INDICES) VARNAME
+
+#define COSIO_DEFINE_NAMED_CACHED_TABLE(VARNAME, NAME, RECORD, INDICES)  COSIO_NAMED_CACHED_TABLE(NAME, RECORD, INDICES) VARNAME
+
 //
 // macros for external table definition
 //
-#define _COSIO_TABLE_EX(RECORD, INDICES, NAME) cosio::table_ex<RECORD, _COSIO_MEMBER_TYPE(&(RECORD::BOOST_PP_SEQ_ELEM(0, INDICES))), NAME>
+#define _COSIO_TABLE_EX(RECORD, INDICES, NAME) cosio::table_ex<RECORD, _COSIO_MEMBER_TYPE(&RECORD::BOOST_PP_SEQ_ELEM(0, INDICES)), NAME>
 
 #define _COSIO_NAME_PROVIDER_EX(TYPENAME, OWNER, CONTRACT, TABLE) \
 struct TYPENAME { \
@@ -217,4 +350,4 @@ _COSIO_NAMED_TABLE_EX(BOOST_PP_SEQ_CAT((__cosio_name_ex)(__COUNTER__)), OWNER, C
 
 #define COSIO_DEFINE_TABLE_EX(VARNAME, OWNER, CONTRACT, TABLE, RECORD, INDICES)  COSIO_NAMED_TABLE_EX(OWNER, CONTRACT, TABLE, RECORD, INDICES) VARNAME
 
-#define COSIO_UNBOUND_TABLE_EX(VARNAME, RECORD, INDICES)  cosio::unbound_table_ex<RECORD, _COSIO_MEMBER_TYPE(&(RECORD::BOOST_PP_SEQ_ELEM(0, INDICES)))> VARNAME
+#define COSIO_UNBOUND_TABLE_EX(VARNAME, RECORD, INDICES)  cosio::unbound_table_ex<RECORD, _COSIO_MEMBER_TYPE(&RECORD::BOOST_PP_SEQ_ELEM(0, INDICES))> VARNAME
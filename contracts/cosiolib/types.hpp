@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string.h>
 #include <vector>
 
 /* macro to align/overalign a type to ensure calls to intrinsics with pointers/references are properly aligned */
@@ -47,6 +48,55 @@ namespace cosio {
         }
     };
     
+    /**
+     * @brief a read-only view of characters owned by another buffer.
+     *
+     * As a contract method parameter, it refers into the parameter buffer of the call instead of
+     * holding a copy, and it's only valid during the call.
+     */
+    class string_view {
+    public:
+        string_view(): _data(nullptr), _size(0) { }
+        
+        string_view(const char* data, size_t size): _data(data), _size(size) { }
+        
+        string_view(const std::string& s): _data(s.data()), _size(s.size()) { }
+        
+        const char* data() const { return _data; }
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        
+        const char* begin() const { return _data; }
+        const char* end() const { return _data + _size; }
+        
+        char operator [] (size_t i) const { return _data[i]; }
+        
+        std::string to_string() const {
+            return std::string(_data, _size);
+        }
+        
+        operator std::string() const {
+            return to_string();
+        }
+        
+        friend bool operator == (const string_view& a, const string_view& b) {
+            return a._size == b._size && (a._size == 0 || memcmp(a._data, b._data, a._size) == 0);
+        }
+        
+        friend bool operator != (const string_view& a, const string_view& b) {
+            return !(a == b);
+        }
+        
+    private:
+        const char* _data;
+        size_t _size;
+    };
+    
+    /**
+     * @brief a read-only view of bytes owned by another buffer, serialized the same as bytes.
+     */
+    using bytes_view = string_view;
+    
     class name {
         constexpr static char COSIO_CONTRACT_NAME_PREFIX_CHAR = '$';
         constexpr static char COSIO_CONTRACT_NAME_SPLIT_CHAR = '@';
@@ -1,5 +1,6 @@
 #include <cosiolib/contract.hpp>
 #include <cosiolib/print.hpp>
+#include <algorithm>
 
 struct voter {
     voter():name(""),haveVoted(false){}
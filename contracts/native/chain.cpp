@@ -0,0 +1,364 @@
+#include "chain.hpp"
+#include <string.h>
+
+namespace cosio { namespace native {
+
+    static const size_t max_call_depth = 16;
+
+    chain::chain() {
+        set_producers({"initminer"});
+    }
+
+    account& chain::create_user(const std::string& name, uint64_t balance) {
+        auto& a = _users[name];
+        a.balance = balance;
+        return a;
+    }
+
+    contract_def& chain::deploy(const std::string& owner, const std::string& name, const abi_def& abi,
+                                std::function<uint32_t()> entry) {
+        _users[owner];
+        auto& c = _contracts[contract_key(owner, name)];
+        c.owner = owner;
+        c.name = name;
+        c.abi.reset(new abi_codec(abi));
+        c.primary_keys.clear();
+        for (const auto& t : abi.tables) {
+            if (!t.keys.empty()) {
+                c.primary_keys[t.name] = t.keys[0];
+            }
+        }
+        c.entry = std::move(entry);
+        return c;
+    }
+
+    void chain::set_block(uint64_t number, uint64_t timestamp) {
+        _block_number = number;
+        _timestamp = timestamp;
+    }
+
+    void chain::set_producers(const std::vector<std::string>& producers) {
+        _producers = producers;
+        for (const auto& p : producers) {
+            _users[p];
+        }
+    }
+
+    void chain::push_action(const std::string& caller, const std::string& owner, const std::string& contract,
+                            const std::string& method, const bytes& params, uint64_t value) {
+        _stats = stats();
+        _console.clear();
+        _frames.clear();
+        _undo.clear();
+        try {
+            frame f;
+            f.contract = &get_contract(owner, contract);
+            f.method = method;
+            f.params = params;
+            f.caller = caller;
+            f.value = value;
+            if (value > 0) {
+                auto& from = get_user(caller);
+                check(from.balance >= value, "insufficient balance of " + caller);
+                set(from.balance, from.balance - value);
+                set(f.contract->balance, f.contract->balance + value);
+            } else {
+                get_user(caller);
+            }
+            run(std::move(f));
+        } catch (...) {
+            for (auto it = _undo.rbegin(); it != _undo.rend(); ++it) {
+                (*it)();
+            }
+            _undo.clear();
+            _frames.clear();
+            throw;
+        }
+        _undo.clear();
+    }
+
+    void chain::run(frame f) {
+        check(bool(f.contract->entry), "no code of contract " + f.contract->owner + "." + f.contract->name);
+        check(_frames.size() < max_call_depth, "too many nested contract calls");
+        _frames.push_back(std::move(f));
+        uint32_t result = _frames.back().contract->entry();
+        check(result == 0, "contract method failed: " + _frames.back().method);
+        _frames.pop_back();
+    }
+
+    const account* chain::find_user(const std::string& name) const {
+        auto it = _users.find(name);
+        return it != _users.end()? &it->second : nullptr;
+    }
+
+    const contract_def* chain::find_contract(const std::string& owner, const std::string& name) const {
+        auto it = _contracts.find(contract_key(owner, name));
+        return it != _contracts.end()? &it->second : nullptr;
+    }
+
+    const chain::table* chain::find_table(const std::string& owner, const std::string& contract, const std::string& table) const {
+        auto it = _tables.find(table_key{owner, contract, table});
+        return it != _tables.end()? &it->second : nullptr;
+    }
+
+    const frame& chain::current() const {
+        if (_frames.empty()) {
+            throw std::logic_error("no contract is running");
+        }
+        return _frames.back();
+    }
+
+    std::string chain::block_producer() const {
+        return _producers.empty()? std::string() : _producers[_block_number % _producers.size()];
+    }
+
+    std::string chain::block_producers() const {
+        std::string names;
+        for (const auto& p : _producers) {
+            if (!names.empty()) {
+                names += ' ';
+            }
+            names += p;
+        }
+        return names;
+    }
+
+    void chain::check(bool pred, const std::string& msg) const {
+        if (!pred) {
+            throw contract_abort(msg);
+        }
+    }
+
+    void chain::require_auth(const std::string& name) const {
+        check(name == current().caller, "missing authority of " + name);
+    }
+
+    uint64_t chain::user_balance(const std::string& name) const {
+        auto a = find_user(name);
+        check(a != nullptr, "unknown user: " + name);
+        return a->balance;
+    }
+
+    uint64_t chain::contract_balance(const std::string& owner, const std::string& contract) const {
+        auto c = find_contract(owner, contract);
+        check(c != nullptr, "unknown contract: " + owner + "." + contract);
+        return c->balance;
+    }
+
+    const bytes* chain::get_record(const std::string& table, const bytes& primary) {
+        _stats.table_reads++;
+        auto& t = current_table(table);
+        auto it = t.find(primary);
+        return it != t.end()? &it->second : nullptr;
+    }
+
+    const bytes* chain::get_record_ex(const std::string& owner, const std::string& contract, const std::string& table, const bytes& primary) {
+        _stats.table_reads++;
+        auto t = find_table(owner, contract, table);
+        if (t == nullptr) {
+            return nullptr;
+        }
+        auto it = t->find(primary);
+        return it != t->end()? &it->second : nullptr;
+    }
+
+    void chain::new_record(const std::string& table, const bytes& value) {
+        // like the node, take the primary key out of the record by the table definition of the ABI.
+        auto& c = *current().contract;
+        auto key_field = c.primary_keys.find(table);
+        check(key_field != c.primary_keys.end(), "table " + table + " is not defined in the ABI");
+        abi_codec::row key;
+        bool found = false;
+        try {
+            found = c.abi->find_field(c.abi->get_table_type(table), key_field->second, value.data(), value.size(), key);
+        } catch (const contento::chain::abi_codec_exception& e) {
+            check(false, "invalid record of table " + table + ": " + e.what());
+        }
+        check(found, "primary key " + key_field->second + " not found in record of table " + table);
+
+        bytes primary(key.data, key.data + key.size);
+        auto& t = current_table(table);
+        check(t.find(primary) == t.end(), "duplicated primary key in table " + table);
+        set_row(t, primary, &value);
+    }
+
+    void chain::update_record(const std::string& table, const bytes& primary, const bytes& value) {
+        auto& t = current_table(table);
+        check(t.find(primary) != t.end(), "record not found in table " + table);
+        set_row(t, primary, &value);
+    }
+
+    void chain::delete_record(const std::string& table, const bytes& primary) {
+        auto& t = current_table(table);
+        check(t.find(primary) != t.end(), "record not found in table " + table);
+        set_row(t, primary, nullptr);
+    }
+
+    void chain::call(const std::string& owner, const std::string& contract, const std::string& method, const bytes& params, uint64_t coins) {
+        auto& target = get_contract(owner, contract);
+        frame f;
+        f.contract = &target;
+        f.method = method;
+        f.params = params;
+        f.caller = current().caller;
+        f.value = coins;
+        f.calling = current().contract;
+        if (coins > 0) {
+            auto& from = *current().contract;
+            check(from.balance >= coins, "insufficient balance of contract " + from.owner + "." + from.name);
+            set(from.balance, from.balance - coins);
+            set(target.balance, target.balance + coins);
+        }
+        _stats.contract_calls++;
+        run(std::move(f));
+    }
+
+    void chain::transfer_to_user(const std::string& to, uint64_t amount, bool vest) {
+        auto& from = *current().contract;
+        auto& user = get_user(to);
+        check(from.balance >= amount, "insufficient balance of contract " + from.owner + "." + from.name);
+        set(from.balance, from.balance - amount);
+        if (vest) {
+            set(user.vesting, user.vesting + amount);
+        } else {
+            set(user.balance, user.balance + amount);
+        }
+    }
+
+    void chain::transfer_to_contract(const std::string& owner, const std::string& contract, uint64_t amount) {
+        auto& from = *current().contract;
+        auto& to = get_contract(owner, contract);
+        check(from.balance >= amount, "insufficient balance of contract " + from.owner + "." + from.name);
+        set(from.balance, from.balance - amount);
+        set(to.balance, to.balance + amount);
+    }
+
+    void chain::set_reputation_admin(const std::string& name) {
+        get_user(name);
+        set(_reputation_admin, name);
+    }
+
+    void chain::set_reputation(const std::string& name, int32_t reputation) {
+        check(current().caller == _reputation_admin, "only the reputation admin can set reputations");
+        auto& user = get_user(name);
+        set(user.reputation, reputation);
+    }
+
+    void chain::set_copyright_admin(const std::string& name) {
+        get_user(name);
+        set(_copyright_admin, name);
+    }
+
+    void chain::set_copyright(uint64_t postid, int32_t copyright) {
+        check(current().caller == _copyright_admin, "only the copyright admin can set copyrights");
+        auto it = _copyrights.find(postid);
+        if (it == _copyrights.end()) {
+            _copyrights[postid] = copyright;
+            _undo.push_back([this, postid]() { _copyrights.erase(postid); });
+        } else {
+            set(it->second, copyright);
+        }
+    }
+
+    void chain::set_freeze(const std::string& name, bool frozen) {
+        auto& user = get_user(name);
+        set(user.frozen, frozen);
+    }
+
+    account& chain::get_user(const std::string& name) {
+        auto it = _users.find(name);
+        check(it != _users.end(), "unknown user: " + name);
+        return it->second;
+    }
+
+    contract_def& chain::get_contract(const std::string& owner, const std::string& name) {
+        auto it = _contracts.find(contract_key(owner, name));
+        check(it != _contracts.end(), "unknown contract: " + owner + "." + name);
+        return it->second;
+    }
+
+    chain::table& chain::current_table(const std::string& name) {
+        const auto& c = *current().contract;
+        return _tables[table_key{c.owner, c.name, name}];
+    }
+
+    void chain::set_row(table& t, const bytes& key, const bytes* value) {
+        _stats.table_writes++;
+        auto it = t.find(key);
+        if (it == t.end()) {
+            _undo.push_back([&t, key]() { t.erase(key); });
+        } else {
+            bytes old = it->second;
+            _undo.push_back([&t, key, old]() { t[key] = old; });
+        }
+        if (value) {
+            t[key] = *value;
+        } else {
+            t.erase(key);
+        }
+    }
+
+    //
+    // SHA-256 of FIPS 180-4.
+    //
+    void sha256(const char* data, size_t size, char* digest) {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+        uint32_t h[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        auto rotr = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+
+        // message, 0x80, zero padding and the 64-bit big endian bit length, in whole 64-byte blocks
+        bytes msg(data, data + size);
+        msg.push_back(char(0x80));
+        while (msg.size() % 64 != 56) {
+            msg.push_back(0);
+        }
+        uint64_t bits = uint64_t(size) * 8;
+        for (int i = 7; i >= 0; i--) {
+            msg.push_back(char(bits >> (i * 8)));
+        }
+
+        for (size_t block = 0; block < msg.size(); block += 64) {
+            uint32_t w[64];
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(msg.data() + block);
+            for (int i = 0; i < 16; i++) {
+                w[i] = (uint32_t(p[4 * i]) << 24) | (uint32_t(p[4 * i + 1]) << 16) | (uint32_t(p[4 * i + 2]) << 8) | p[4 * i + 3];
+            }
+            for (int i = 16; i < 64; i++) {
+                uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+            for (int i = 0; i < 64; i++) {
+                uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+                uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                hh = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+            h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+        }
+        for (int i = 0; i < 8; i++) {
+            for (int j = 0; j < 4; j++) {
+                digest[4 * i + j] = char(h[i] >> (24 - 8 * j));
+            }
+        }
+    }
+
+    chain*& current_chain() {
+        static chain* c = nullptr;
+        return c;
+    }
+
+} } /// namespace cosio::native
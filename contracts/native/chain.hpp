@@ -0,0 +1,192 @@
+#pragma once
+
+#include <contento/abi_generator/abi_codec.hpp>
+#include <functional>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//
+// In-process stand-in of a chain node, for running contracts off-chain.
+//
+// It keeps accounts, contracts and their tables in memory, and implements the semantics behind every
+// function of cosiolib/system.h on top of them. The contract code itself is supplied by the embedder,
+// as an entry function per deployed contract: system.cpp binds system.h to a chain so that a contract
+// compiled for the host (cosiocc --native) runs natively.
+//
+namespace cosio { namespace native {
+
+    using bytes = std::vector<char>;
+    using contento::chain::abi_codec;
+    using contento::chain::abi_def;
+
+    /**
+     * @brief thrown when a contract aborts, by cos_assert() or a failed host check.
+     */
+    struct contract_abort : public std::runtime_error {
+        explicit contract_abort(const std::string& what): std::runtime_error(what) { }
+    };
+
+    struct account {
+        uint64_t balance = 0;
+        uint64_t vesting = 0;
+        int32_t reputation = 0;
+        bool frozen = false;
+    };
+
+    struct contract_def {
+        std::string owner;
+        std::string name;
+        uint64_t balance = 0;
+        std::unique_ptr<abi_codec> abi;
+        std::map<std::string, std::string> primary_keys;    ///< primary key field of each table
+        std::function<uint32_t()> entry;        ///< runs apply() of the contract, empty if it has no code here
+    };
+
+    /**
+     * @brief a contract invocation, i.e. what read_contract_xxx() functions return.
+     */
+    struct frame {
+        contract_def* contract = nullptr;
+        std::string method;
+        bytes params;
+        std::string caller;                     ///< the user who signed the transaction
+        uint64_t value = 0;                     ///< coins sent with the call
+        const contract_def* calling = nullptr;  ///< the calling contract, or nullptr if called by a user
+    };
+
+    class chain {
+    public:
+        using table = std::map<bytes, bytes>;
+
+        /**
+         * @brief counters of a single push_action(), including nested contract calls.
+         */
+        struct stats {
+            uint32_t host_calls = 0;
+            uint32_t contract_calls = 0;
+            uint32_t table_reads = 0;
+            uint32_t table_writes = 0;
+        };
+
+        chain();
+
+        // setup
+        account& create_user(const std::string& name, uint64_t balance = 0);
+        contract_def& deploy(const std::string& owner, const std::string& name, const abi_def& abi,
+                             std::function<uint32_t()> entry = nullptr);
+        void set_block(uint64_t number, uint64_t timestamp);
+        void set_producers(const std::vector<std::string>& producers);
+
+        /**
+         * @brief run a contract method as a transaction signed by @p caller.
+         *
+         * All state changes, including those of nested contract calls, are undone if the contract aborts,
+         * in which case contract_abort is rethrown.
+         */
+        void push_action(const std::string& caller, const std::string& owner, const std::string& contract,
+                         const std::string& method, const bytes& params, uint64_t value = 0);
+
+        const stats& last_stats() const { return _stats; }
+        std::string& console() { return _console; }
+
+        // state inspection
+        const account* find_user(const std::string& name) const;
+        const contract_def* find_contract(const std::string& owner, const std::string& name) const;
+        const table* find_table(const std::string& owner, const std::string& contract, const std::string& table) const;
+        const std::string& reputation_admin() const { return _reputation_admin; }
+        const std::string& copyright_admin() const { return _copyright_admin; }
+        const std::map<uint64_t, int32_t>& copyrights() const { return _copyrights; }
+
+        //
+        // host API, called from within a contract; failures abort the contract.
+        //
+        const frame& current() const;
+        void host_call() { _stats.host_calls++; }
+
+        uint64_t block_number() const { return _block_number; }
+        uint64_t timestamp() const { return _timestamp; }
+        std::string block_producer() const;
+        std::string block_producers() const;
+
+        void print(const char* s, size_t size) { _console.append(s, size); }
+        void check(bool pred, const std::string& msg) const;
+
+        void require_auth(const std::string& name) const;
+        bool user_exists(const std::string& name) const { return _users.count(name) > 0; }
+        uint64_t user_balance(const std::string& name) const;
+        uint64_t contract_balance(const std::string& owner, const std::string& contract) const;
+
+        const bytes* get_record(const std::string& table, const bytes& primary);
+        const bytes* get_record_ex(const std::string& owner, const std::string& contract, const std::string& table, const bytes& primary);
+        void new_record(const std::string& table, const bytes& value);
+        void update_record(const std::string& table, const bytes& primary, const bytes& value);
+        void delete_record(const std::string& table, const bytes& primary);
+
+        void call(const std::string& owner, const std::string& contract, const std::string& method, const bytes& params, uint64_t coins);
+        void transfer_to_user(const std::string& to, uint64_t amount, bool vest);
+        void transfer_to_contract(const std::string& owner, const std::string& contract, uint64_t amount);
+
+        void set_reputation_admin(const std::string& name);
+        void set_reputation(const std::string& name, int32_t reputation);
+        void set_copyright_admin(const std::string& name);
+        void set_copyright(uint64_t postid, int32_t copyright);
+        void set_freeze(const std::string& name, bool frozen);
+
+    private:
+        using contract_key = std::pair<std::string, std::string>;
+
+        struct table_key {
+            std::string owner;
+            std::string contract;
+            std::string table;
+
+            bool operator < (const table_key& other) const {
+                return std::tie(owner, contract, table) < std::tie(other.owner, other.contract, other.table);
+            }
+        };
+
+        account& get_user(const std::string& name);
+        contract_def& get_contract(const std::string& owner, const std::string& name);
+        table& current_table(const std::string& name);
+        void run(frame f);
+
+        template<typename T>
+        void set(T& var, T value) {
+            T old = var;
+            _undo.push_back([&var, old]() { var = old; });
+            var = value;
+        }
+        void set_row(table& t, const bytes& key, const bytes* value);
+
+        std::map<std::string, account> _users;
+        std::map<contract_key, contract_def> _contracts;
+        std::map<table_key, table> _tables;
+
+        uint64_t _block_number = 1;
+        uint64_t _timestamp = 0;
+        std::vector<std::string> _producers;
+        std::string _reputation_admin;
+        std::string _copyright_admin;
+        std::map<uint64_t, int32_t> _copyrights;
+
+        std::vector<frame> _frames;
+        std::vector<std::function<void()>> _undo;
+        std::string _console;
+        stats _stats;
+    };
+
+    /**
+     * @brief SHA-256 digest of @p size bytes at @p data, written to the 32 bytes at @p digest.
+     */
+    void sha256(const char* data, size_t size, char* digest);
+
+    /**
+     * @brief the chain that system.h functions of natively built contracts operate on.
+     */
+    chain*& current_chain();
+
+} } /// namespace cosio::native
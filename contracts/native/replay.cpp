@@ -0,0 +1,166 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+//
+// Replays an action trace (see trace.hpp) on a natively built contract, and reports the latency
+// of every action.
+//
+// usage: replay [options] contract.abi trace
+//
+
+extern "C" uint32_t apply();
+
+using namespace cosio::native;
+
+namespace {
+
+    struct latency_stats {
+        std::vector<double> samples;    ///< microseconds
+        size_t aborts = 0;
+    };
+
+    void usage() {
+        std::cerr << "usage: replay [options] contract.abi trace" << std::endl
+                  << "options:" << std::endl
+                  << "   --owner NAME      owner account of the contract (default initminer)" << std::endl
+                  << "   --contract NAME   name of the contract (default: the ABI file name)" << std::endl
+                  << "   --repeat N        replay the actions of the trace N times (default 1)" << std::endl
+                  << "   --summary         report latency per method only, not per action" << std::endl
+                  << "   --print           show what the contract prints" << std::endl;
+    }
+
+    double percentile(std::vector<double>& v, double p) {
+        if (v.empty()) {
+            return 0;
+        }
+        size_t i = std::min(v.size() - 1, size_t(p * v.size()));
+        std::nth_element(v.begin(), v.begin() + i, v.end());
+        return v[i];
+    }
+
+}
+
+int main(int argc, char** argv) {
+    std::string owner = "initminer", contract, abi_path, trace_path;
+    size_t repeat = 1;
+    bool summary = false, show_print = false;
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (size_t i = 0; i < args.size(); i++) {
+        const auto& a = args[i];
+        bool has_value = i + 1 < args.size();
+        if (a == "--owner" && has_value) {
+            owner = args[++i];
+        } else if (a == "--contract" && has_value) {
+            contract = args[++i];
+        } else if (a == "--repeat" && has_value) {
+            repeat = std::stoul(args[++i]);
+        } else if (a == "--summary") {
+            summary = true;
+        } else if (a == "--print") {
+            show_print = true;
+        } else if (a == "-h" || a == "--help") {
+            usage();
+            return 0;
+        } else if (a[0] == '-') {
+            usage();
+            return 1;
+        } else if (abi_path.empty()) {
+            abi_path = a;
+        } else if (trace_path.empty()) {
+            trace_path = a;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (trace_path.empty()) {
+        usage();
+        return 1;
+    }
+    if (contract.empty()) {
+        auto base = abi_path.substr(abi_path.find_last_of('/') + 1);
+        contract = base.substr(0, base.find('.'));
+    }
+
+    chain c;
+    current_chain() = &c;
+    std::vector<trace_step> steps;
+    try {
+        auto& def = c.deploy(owner, contract, load_abi(abi_path), apply);
+        steps = load_trace(trace_path, *def.abi);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::map<std::string, latency_stats> methods;
+    size_t actions = 0, aborts = 0;
+    double total_us = 0;
+    using clock = std::chrono::steady_clock;
+
+    for (size_t round = 0; round < repeat; round++) {
+        for (const auto& s : steps) {
+            if (s.kind == trace_step::create_user) {
+                if (round == 0) {
+                    c.create_user(s.name, s.args[0]);
+                }
+                continue;
+            } else if (s.kind == trace_step::set_block) {
+                c.set_block(s.args[0], s.args[1]);
+                continue;
+            }
+            const auto& a = s.action;
+            std::string error;
+            auto start = clock::now();
+            try {
+                c.push_action(a.caller, owner, contract, a.method, a.params, a.value);
+            } catch (const contract_abort& e) {
+                error = e.what();
+            }
+            double us = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+
+            auto& m = methods[a.method];
+            m.samples.push_back(us);
+            total_us += us;
+            actions++;
+            if (!error.empty()) {
+                m.aborts++;
+                aborts++;
+            }
+            if (!summary) {
+                const auto& st = c.last_stats();
+                std::cout << "line " << a.line << ": " << a.method << " " << us << "us"
+                          << " host_calls=" << st.host_calls << " table_reads=" << st.table_reads
+                          << " table_writes=" << st.table_writes << " contract_calls=" << st.contract_calls;
+                if (!error.empty()) {
+                    std::cout << " ABORTED: " << error;
+                }
+                std::cout << std::endl;
+            }
+            if (show_print && !c.console().empty()) {
+                std::cout << c.console() << std::endl;
+            }
+        }
+    }
+
+    std::cout << actions << " actions, " << aborts << " aborted, " << total_us / 1000 << "ms";
+    if (total_us > 0) {
+        std::cout << ", " << uint64_t(actions / (total_us / 1e6)) << " actions/s";
+    }
+    std::cout << std::endl;
+    for (auto& kv : methods) {
+        auto& m = kv.second;
+        double sum = 0;
+        for (auto us : m.samples) {
+            sum += us;
+        }
+        std::cout << "  " << kv.first << ": " << m.samples.size() << " calls, " << m.aborts << " aborted"
+                  << ", mean " << sum / m.samples.size() << "us"
+                  << ", p50 " << percentile(m.samples, 0.5) << "us"
+                  << ", p99 " << percentile(m.samples, 0.99) << "us" << std::endl;
+    }
+    return 0;
+}
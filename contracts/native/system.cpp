@@ -0,0 +1,238 @@
+#include <cosiolib/system.h>
+#include "chain.hpp"
+#include <algorithm>
+#include <string.h>
+
+//
+// system.h for contracts built to run natively, on the chain returned by cosio::native::current_chain().
+//
+// Contract aborts are thrown as cosio::native::contract_abort, out of apply() and back into
+// chain::push_action(). abort() is left to the C library of the host: it ends the process, as
+// a contract crashing the emulator is better noticed than rolled back.
+//
+
+using cosio::native::bytes;
+
+namespace {
+
+    cosio::native::chain& host() {
+        auto c = cosio::native::current_chain();
+        c->host_call();
+        return *c;
+    }
+
+    std::string to_string(const char* s, int size) {
+        return std::string(s, size > 0? size : 0);
+    }
+
+    bytes to_bytes(const char* s, int size) {
+        return bytes(s, s + (size > 0? size : 0));
+    }
+
+    // host readers copy as much as fits if size is positive, and return the data size otherwise.
+    int read_out(const char* data, size_t data_size, char* buf, int size) {
+        if (size <= 0) {
+            return (int)data_size;
+        }
+        int n = std::min(size, (int)data_size);
+        memcpy(buf, data, n);
+        return n;
+    }
+
+    int read_out(const std::string& s, char* buf, int size) {
+        return read_out(s.data(), s.size(), buf, size);
+    }
+
+    int read_record(const bytes* record, char* value, int value_len) {
+        return record? read_out(record->data(), record->size(), value, value_len) : 0;
+    }
+
+}
+
+extern "C" {
+
+unsigned long long current_block_number() {
+    return host().block_number();
+}
+
+unsigned long long current_timestamp() {
+    return host().timestamp();
+}
+
+int current_block_producer(char* buffer, int size) {
+    return read_out(host().block_producer(), buffer, size);
+}
+
+int get_block_producers(char *buffer, int size) {
+    return read_out(host().block_producers(), buffer, size);
+}
+
+int sha256(char* buffer, int size, char* hash, int hash_size) {
+    host();
+    char digest[32];
+    cosio::native::sha256(buffer, size > 0? size : 0, digest);
+    return read_out(digest, sizeof(digest), hash, hash_size);
+}
+
+void print_str(char*s, int l) {
+    host().print(s, l > 0? l : 0);
+}
+
+void print_int(long long n) {
+    auto s = std::to_string(n);
+    host().print(s.data(), s.size());
+}
+
+void print_uint(unsigned long long n) {
+    auto s = std::to_string(n);
+    host().print(s.data(), s.size());
+}
+
+void require_auth(char* name, int length) {
+    host().require_auth(to_string(name, length));
+}
+
+unsigned long long get_user_balance(char* name, int length) {
+    return host().user_balance(to_string(name, length));
+}
+
+int user_exist(char* name, int length) {
+    return host().user_exists(to_string(name, length))? 1 : 0;
+}
+
+unsigned long long get_contract_balance(char* owner, int owner_len, char* contract, int contract_len) {
+    return host().contract_balance(to_string(owner, owner_len), to_string(contract, contract_len));
+}
+
+int table_get_record(char *table_name, int table_name_len, char* primary, int primary_len, char* value, int value_len) {
+    auto record = host().get_record(to_string(table_name, table_name_len), to_bytes(primary, primary_len));
+    return read_record(record, value, value_len);
+}
+
+void table_new_record(char *table_name, int table_name_len, char* value, int value_len) {
+    host().new_record(to_string(table_name, table_name_len), to_bytes(value, value_len));
+}
+
+void table_update_record(char *table_name, int table_name_len, char* primary, int primary_len, char* value, int value_len) {
+    host().update_record(to_string(table_name, table_name_len), to_bytes(primary, primary_len), to_bytes(value, value_len));
+}
+
+void table_delete_record(char *table_name, int table_name_len, char* primary, int primary_len) {
+    host().delete_record(to_string(table_name, table_name_len), to_bytes(primary, primary_len));
+}
+
+int table_get_record_ex(char *owner_name, int owner_name_len, char *contract_name, int contract_name_len, char *table_name, int table_name_len, char* primary, int primary_len, char* value, int value_len) {
+    auto record = host().get_record_ex(to_string(owner_name, owner_name_len), to_string(contract_name, contract_name_len),
+                                       to_string(table_name, table_name_len), to_bytes(primary, primary_len));
+    return read_record(record, value, value_len);
+}
+
+void cos_assert(int pred, char* msg, int msg_len) {
+    host().check(pred != 0, to_string(msg, msg_len));
+}
+
+int read_contract_op_params(char* buf, int size) {
+    const auto& params = host().current().params;
+    return read_out(params.data(), params.size(), buf, size);
+}
+
+unsigned long long read_contract_sender_value() {
+    return host().current().value;
+}
+
+int read_contract_name(char* buf, int size) {
+    return read_out(host().current().contract->name, buf, size);
+}
+
+int read_contract_method(char* buf, int size) {
+    return read_out(host().current().method, buf, size);
+}
+
+int read_contract_owner(char* buf, int size) {
+    return read_out(host().current().contract->owner, buf, size);
+}
+
+int read_contract_caller(char* buf, int size) {
+    return read_out(host().current().caller, buf, size);
+}
+
+int contract_called_by_user() {
+    return host().current().calling == nullptr? 1 : 0;
+}
+
+int read_calling_contract_owner(char *buf, int size) {
+    auto calling = host().current().calling;
+    return calling? read_out(calling->owner, buf, size) : 0;
+}
+
+int read_calling_contract_name(char *buf, int size) {
+    auto calling = host().current().calling;
+    return calling? read_out(calling->name, buf, size) : 0;
+}
+
+void contract_call(char *owner, int owner_size, char *contract, int contract_size, char *method, int method_size, char *params, int params_size, unsigned long long coins) {
+    host().call(to_string(owner, owner_size), to_string(contract, contract_size), to_string(method, method_size),
+                to_bytes(params, params_size), coins);
+}
+
+void transfer_to_user( char* to, int to_len, unsigned long long amount, char* memo, int memo_len) {
+    host().transfer_to_user(to_string(to, to_len), amount, false);
+}
+
+void transfer_to_user_vest( char* to, int to_len, unsigned long long amount, char* memo, int memo_len) {
+    host().transfer_to_user(to_string(to, to_len), amount, true);
+}
+
+void transfer_to_contract( char* to_owner, int to_owner_len, char* to_contract, int to_contract_len, unsigned long long amount, char* memo, int memo_len) {
+    host().transfer_to_contract(to_string(to_owner, to_owner_len), to_string(to_contract, to_contract_len), amount);
+}
+
+int get_reputation_admin(char* buffer, int size) {
+    return read_out(host().reputation_admin(), buffer, size);
+}
+
+void set_reputation_admin(char* name, int name_len) {
+    host().set_reputation_admin(to_string(name, name_len));
+}
+
+// array arguments are passed with their sizes in bytes.
+
+int set_reputation(char** names, int names_len, int* name_sizes, int name_sizes_len, int *reputations, int reputations_len, char **memos, int memos_len, int *memo_sizes, int memo_sizes_len) {
+    auto& h = host();
+    size_t count = names_len / sizeof(char*);
+    h.check(count == name_sizes_len / sizeof(int) && count == reputations_len / sizeof(int) &&
+            count == memos_len / sizeof(char*) && count == memo_sizes_len / sizeof(int), "illegal parameters");
+    for (size_t i = 0; i < count; i++) {
+        h.set_reputation(to_string(names[i], name_sizes[i]), reputations[i]);
+    }
+    return 0;
+}
+
+void set_copyright_admin(char* name, int name_len) {
+    host().set_copyright_admin(to_string(name, name_len));
+}
+
+int set_copyright(int* postids, int postids_len, int *copyrights, int copyrights_len, char **memos, int memos_len, int *memo_sizes, int memo_sizes_len) {
+    auto& h = host();
+    size_t count = postids_len / sizeof(unsigned long long);
+    h.check(count == copyrights_len / sizeof(int) &&
+            count == memos_len / sizeof(char*) && count == memo_sizes_len / sizeof(int), "illegal parameters");
+    auto ids = reinterpret_cast<const unsigned long long*>(postids);
+    for (size_t i = 0; i < count; i++) {
+        h.set_copyright(ids[i], copyrights[i]);
+    }
+    return 0;
+}
+
+int set_freeze(char** names, int names_len, int* name_sizes, int name_sizes_len, int op, char **memos, int memos_len, int *memo_sizes, int memo_sizes_len) {
+    auto& h = host();
+    size_t count = names_len / sizeof(char*);
+    h.check(count == name_sizes_len / sizeof(int) &&
+            count == memos_len / sizeof(char*) && count == memo_sizes_len / sizeof(int), "illegal parameters");
+    for (size_t i = 0; i < count; i++) {
+        h.set_freeze(to_string(names[i], name_sizes[i]), op != 0);
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,84 @@
+#include "trace.hpp"
+#include <fstream>
+#include <sstream>
+
+namespace cosio { namespace native {
+
+    static bytes from_hex(const std::string& hex) {
+        if (hex.size() % 2) {
+            throw std::runtime_error("hex string has an odd number of digits");
+        }
+        auto digit = [](char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            throw std::runtime_error(std::string("invalid hex digit '") + c + "'");
+        };
+        bytes b;
+        for (size_t i = 0; i < hex.size(); i += 2) {
+            b.push_back(char((digit(hex[i]) << 4) | digit(hex[i + 1])));
+        }
+        return b;
+    }
+
+    std::vector<trace_step> load_trace(const std::string& path, const abi_codec& codec) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        std::vector<trace_step> steps;
+        std::string text;
+        for (size_t line = 1; std::getline(in, text); line++) {
+            std::istringstream ss(text);
+            std::string first;
+            if (!(ss >> first) || first[0] == '#') {
+                continue;
+            }
+            try {
+                trace_step s;
+                if (first == "user") {
+                    s.kind = trace_step::create_user;
+                    if (!(ss >> s.name)) {
+                        throw std::runtime_error("user name expected");
+                    }
+                    ss >> s.args[0];
+                } else if (first == "block") {
+                    s.kind = trace_step::set_block;
+                    if (!(ss >> s.args[0])) {
+                        throw std::runtime_error("block number expected");
+                    }
+                    ss >> s.args[1];
+                } else {
+                    auto& a = s.action;
+                    s.kind = trace_step::push_action;
+                    a.line = line;
+                    a.caller = first;
+                    std::string params;
+                    if (!(ss >> a.method >> a.value) || !(ss >> std::ws) || !std::getline(ss, params)) {
+                        throw std::runtime_error("expected CALLER METHOD VALUE PARAMS");
+                    }
+                    if (params[0] == '{') {
+                        codec.pack(codec.get_action_type(a.method), contento::chain::json::parse(params), a.params);
+                    } else if (params != "-") {
+                        a.params = from_hex(params);
+                    }
+                }
+                steps.push_back(std::move(s));
+            } catch (const std::exception& e) {
+                throw std::runtime_error(path + ":" + std::to_string(line) + ": " + e.what());
+            }
+        }
+        return steps;
+    }
+
+    abi_def load_abi(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        abi_def abi;
+        abi.from_json2(contento::chain::json::parse(in));
+        return abi;
+    }
+
+} } /// namespace cosio::native
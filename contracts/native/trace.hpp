@@ -0,0 +1,51 @@
+#pragma once
+
+#include "chain.hpp"
+
+//
+// Action traces, as replayed on a contract by the native replay driver and by cosio-run.
+//
+// A trace is a text file, one command per line; empty lines and lines starting with '#' are skipped.
+//
+//      user NAME [BALANCE]                     create a user account
+//      block NUMBER [TIMESTAMP]                set head block number and timestamp
+//      CALLER METHOD VALUE PARAMS              call METHOD of the contract, signed by CALLER, sending
+//                                              VALUE coins. PARAMS is the rest of the line, either the
+//                                              packed parameters in hex, "-" if there are none, or the
+//                                              parameters as a JSON object, packed by the ABI.
+//
+// e.g.
+//      user alice 1000
+//      initminer create 0 {"name":"test token","symbol":"TT","total_supply":1000000,"decimals":3}
+//      initminer transfer 0 {"from":"initminer","to":"alice","amount":100}
+//
+namespace cosio { namespace native {
+
+    struct trace_action {
+        size_t line = 0;
+        std::string caller;
+        std::string method;
+        uint64_t value = 0;
+        bytes params;
+    };
+
+    struct trace_step {
+        enum { create_user, set_block, push_action } kind;
+        std::string name;
+        uint64_t args[2] = {0, 0};
+        trace_action action;
+    };
+
+    /**
+     * @brief parse a trace file, packing JSON parameters with the ABI of the contract.
+     *
+     * Throws std::runtime_error naming the file and line of the first error.
+     */
+    std::vector<trace_step> load_trace(const std::string& path, const abi_codec& codec);
+
+    /**
+     * @brief read an ABI file generated by cosiocc -g.
+     */
+    abi_def load_abi(const std::string& path);
+
+} } /// namespace cosio::native
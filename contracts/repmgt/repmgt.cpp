@@ -1,5 +1,6 @@
 #include <cosiolib/contract.hpp>
 #include <cosiolib/print.hpp>
+#include <algorithm>
 
 const uint32_t expire_blocks = 86400;
 
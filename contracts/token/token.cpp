@@ -122,8 +122,10 @@ struct cosToken : public cosio::contract {
     // - has name of "balances", the same as variable name,
     // - has a record type of balance
     // - takes balance::tokenOwner as primary key
+    // - caches records during the call, so that repeated reads of the same balance
+    //   don't go to the database, and changes are written back once when the call ends.
     //
-    COSIO_DEFINE_TABLE( balances, balance, (tokenOwner) );
+    COSIO_DEFINE_CACHED_TABLE( balances, balance, (tokenOwner) );
 
     //
     // define a class data member named "stats" representing a singleton table which,
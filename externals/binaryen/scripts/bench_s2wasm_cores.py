@@ -0,0 +1,72 @@
+#! /usr/bin/env python
+
+'''
+Benchmarks how cosio-s2wasm -O scales with cores, on the synthetic .s of
+bench_s2wasm_input.py with a few huge functions added, the way libc++
+__tree or regex instantiations show up in a linked contract.
+
+Usage: bench_s2wasm_cores.py path/to/cosio-s2wasm [MEGABYTES] [HUGE] [MAXCORES]
+
+The file (20 MB and 8 huge functions by default) is written as
+bench-cores.s and kept. cosio-s2wasm runs with BINARYEN_CORES set to
+1, 2, 4, ... up to MAXCORES (32 by default), and for each the wall time
+of the run and of its function-parallel passes is printed, with the
+speedup over 1 core, and how long the first thread to run out of work
+sat idle before the last one was done (from --pass-stats).
+'''
+
+from __future__ import print_function
+
+import json
+import os
+import subprocess
+import sys
+import time
+
+from bench_s2wasm_input import generate
+
+
+def run(s2wasm, path, cores):
+  env = dict(os.environ, BINARYEN_CORES=str(cores))
+  stats = 'bench-cores.json'
+  start = time.time()
+  subprocess.check_call([s2wasm, path, '-O2', '-o', os.devnull, '--emit-binary',
+                         '--validate', 'none', '--pass-stats', stats], env=env)
+  elapsed = time.time() - start
+  with open(stats) as f:
+    data = json.load(f)
+  parallel = sum(s['wall'] for s in data['stacks'])
+  idle = 0
+  for stack in range(len(data['stacks'])):
+    ends = [c['end'] for c in data['chunks'] if c['stack'] == stack]
+    if ends:
+      idle += max(ends) - min(ends)
+  return elapsed, parallel, idle
+
+
+def main():
+  if len(sys.argv) < 2:
+    print(__doc__)
+    sys.exit(1)
+  s2wasm = sys.argv[1]
+  megabytes = int(sys.argv[2]) if len(sys.argv) > 2 else 20
+  huge = int(sys.argv[3]) if len(sys.argv) > 3 else 8
+  maxcores = int(sys.argv[4]) if len(sys.argv) > 4 else 32
+  path = 'bench-cores.s'
+  if not os.path.exists(path):
+    print('writing %s...' % path)
+    generate(path, megabytes, huge)
+  print('%s: %.1f MB' % (path, os.path.getsize(path) / (1024.0 * 1024)))
+  base = None
+  cores = 1
+  while cores <= maxcores:
+    elapsed, parallel, idle = run(s2wasm, path, cores)
+    if base is None:
+      base = (elapsed, parallel)
+    print('%2d cores: %.2fs wall (%.2fx), function-parallel passes %.2fs (%.2fx), idle tail %.2fs' %
+          (cores, elapsed, base[0] / elapsed, parallel, base[1] / parallel, idle))
+    cores *= 2
+
+
+if __name__ == '__main__':
+  main()
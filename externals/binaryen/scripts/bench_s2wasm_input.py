@@ -0,0 +1,105 @@
+#! /usr/bin/env python
+
+'''
+Benchmarks how fast cosio-s2wasm reads its input, and with how much memory,
+on a synthetic .s file of linked-contract shape: many small functions that
+call each other and reference data, and data objects of .ascii/.asciz
+strings and relocated .int32 words.
+
+Usage: bench_s2wasm_input.py path/to/cosio-s2wasm [MEGABYTES] [RUNS]
+
+The file (100 MB by default) is written next to this script's working
+directory as bench-input.s and kept, so that runs of two builds of
+cosio-s2wasm can be compared on the same input. Every run is timed, and
+its peak RSS is read from the kernel. Set BINARYEN_CORES to compare the
+sequential and parallel parsers.
+'''
+
+from __future__ import print_function
+
+import os
+import random
+import resource
+import subprocess
+import sys
+import time
+
+FUNCTIONS_PER_DATA = 8
+
+
+def write_function(out, i, count, instructions=None):
+  name = 'f%d' % i
+  out.write('\t.globl\t%s\n\t.type\t%s,@function\n%s:\n' % (name, name, name))
+  out.write('\t.param  \ti32, i32\n\t.result \ti32\n\t.local  \ti32, i32\n')
+  for k in range(instructions or random.randint(4, 24)):
+    r = random.random()
+    if r < 0.3:
+      out.write('\ti32.add \t$push%d=, $0, $1\n' % k)
+    elif r < 0.5:
+      out.write('\ti32.call\t$push%d=, f%d@FUNCTION, $0, $2\n' % (k, random.randrange(count)))
+    elif r < 0.7:
+      out.write('\ti32.load\t$push%d=, .Lstr%d+4($0)\n' % (k, random.randrange(count // FUNCTIONS_PER_DATA + 1)))
+    else:
+      out.write('\ti32.const\t$push%d=, %d\n' % (k, random.randint(-1000, 100000)))
+    out.write('\tcopy_local\t$2=, $pop%d\n' % k)
+  out.write('\treturn  \t$2\n\t.endfunc\n')
+  out.write('.Lfunc_end%d:\n\t.size\t%s, .Lfunc_end%d-%s\n\n' % (i, name, i, name))
+
+
+def write_data(out, i, count):
+  name = '.Lstr%d' % i
+  text = ''.join(random.choice('abcdefghijklmnopqrstuvwxyz ,.:') for _ in range(random.randint(16, 200)))
+  out.write('\t.type\t%s,@object\n\t.section\t.rodata.str,"aMS",@progbits,1\n' % name)
+  out.write('%s:\n\t.asciz\t"%s\\n\\t\\"%s\\\\\\000"\n' % (name, text[:len(text) // 2], text[len(text) // 2:]))
+  out.write('\t.int32\tf%d@FUNCTION\n\t.int32\t%d\n' % (random.randrange(count), i))
+  out.write('\t.ascii\t"%s"\n\n' % text)
+
+
+def generate(path, megabytes, huge=0):
+  random.seed(1)
+  target = megabytes * 1024 * 1024
+  # a function and its share of the data take about 1 KB
+  count = max(FUNCTIONS_PER_DATA, target // 1000)
+  with open(path, 'w') as out:
+    out.write('\t.text\n')
+    for i in range(count):
+      # the huge functions, if any, are spread evenly over the file
+      large = huge and i % (count // huge) == count // huge - 1
+      write_function(out, i, count, 20000 if large else None)
+    for i in range(count // FUNCTIONS_PER_DATA + 1):
+      write_data(out, i, count)
+  return count
+
+
+def run(s2wasm, path):
+  before = resource.getrusage(resource.RUSAGE_CHILDREN)
+  start = time.time()
+  # a binary without validation, to leave mostly the parse and the link
+  subprocess.check_call([s2wasm, path, '-o', os.devnull, '--emit-binary', '--validate', 'none'])
+  elapsed = time.time() - start
+  after = resource.getrusage(resource.RUSAGE_CHILDREN)
+  # ru_maxrss of children is the largest of any of them so far, so it only
+  # tells about this run when it grows; the first run is the one to trust
+  return elapsed, after.ru_utime - before.ru_utime, after.ru_maxrss
+
+
+def main():
+  if len(sys.argv) < 2:
+    print(__doc__)
+    sys.exit(1)
+  s2wasm = sys.argv[1]
+  megabytes = int(sys.argv[2]) if len(sys.argv) > 2 else 100
+  runs = int(sys.argv[3]) if len(sys.argv) > 3 else 3
+  path = 'bench-input.s'
+  if not os.path.exists(path) or os.path.getsize(path) < megabytes * 1024 * 1024 * 0.9:
+    print('writing %s...' % path)
+    count = generate(path, megabytes)
+    print('%d functions' % count)
+  print('%s: %.1f MB' % (path, os.path.getsize(path) / (1024.0 * 1024)))
+  for i in range(runs):
+    elapsed, user, maxrss = run(s2wasm, path)
+    print('run %d: %.2fs wall, %.2fs user, peak RSS %.1f MB' % (i + 1, elapsed, user, maxrss / 1024.0))
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,138 @@
+#! /usr/bin/env python
+
+'''
+Checks the charges cosio-s2wasm --gas-metering puts into a small module
+with a loop, br_ifs and blocks that are branched to, and that the
+metered module still validates. Each function's gas_charge constants are
+compared, in order, with the expected ones.
+
+Built with -O2, the br_ifs carry values and the blocks they target
+produce them, so the charges placed after those blocks have to keep the
+values alive.
+
+Usage: test_s2wasm_gas_metering.py path/to/cosio-s2wasm [WORKDIR]
+
+The expected charges follow the weights of CostAnalyzer, and, for -O2,
+the code the optimizer produces; a change to either has to update them.
+'''
+
+from __future__ import print_function
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+INPUT = '''\
+\t.text
+\t.globl\tsum
+\t.type\tsum,@function
+sum:
+\t.param  \ti32
+\t.result \ti32
+\t.local  \ti32
+\ti32.const\t$1=, 0
+\tloop    \t
+\ti32.add \t$1=, $1, $0
+\ti32.const\t$push0=, -1
+\ti32.add \t$0=, $0, $pop0
+\tbr_if   \t0, $0
+\tend_loop
+\treturn  \t$1
+\t.endfunc
+.Lfunc_end0:
+\t.size\tsum, .Lfunc_end0-sum
+
+\t.globl\tpick
+\t.type\tpick,@function
+pick:
+\t.param  \ti32, i32
+\t.result \ti32
+\t.local  \ti32
+\ti32.const\t$2=, 7
+\tblock   \t
+\tbr_if   \t0, $0
+\ti32.mul \t$2=, $1, $1
+\tend_block
+\ti32.add \t$push0=, $2, $1
+\treturn  \t$pop0
+\t.endfunc
+.Lfunc_end1:
+\t.size\tpick, .Lfunc_end1-pick
+
+\t.globl\tchoose
+\t.type\tchoose,@function
+choose:
+\t.param  \ti32, i32
+\t.result \ti32
+\t.local  \ti32
+\tblock   \t
+\ti32.const\t$2=, 7
+\tbr_if   \t0, $0
+\ti32.mul \t$2=, $1, $1
+\tend_block
+\ti32.call\t$push0=, choose@FUNCTION, $2, $1
+\treturn  \t$pop0
+\t.endfunc
+.Lfunc_end2:
+\t.size\tchoose, .Lfunc_end2-choose
+'''
+
+# the gas_charge constants of each function, in text order
+EXPECTED = {
+  '-O0': {
+    'sum':    [2, 6],
+    'pick':   [3, 3, 1],
+    'choose': [3, 3, 4],
+  },
+  '-O2': {
+    'sum':    [2, 6],
+    'pick':   [4, 3, 1],
+    'choose': [2, 2, 4],
+  },
+}
+
+FUNC = re.compile(r'^ \(func \$(\w+)', re.M)
+CHARGE = re.compile(r'\(call \$gas_charge\s+\(i32\.const (\d+)\)')
+
+
+def charges(wast):
+  result = {}
+  starts = list(FUNC.finditer(wast))
+  for i, match in enumerate(starts):
+    end = starts[i + 1].start() if i + 1 < len(starts) else len(wast)
+    result[match.group(1)] = [int(c) for c in CHARGE.findall(wast, match.end(), end)]
+  return result
+
+
+def main():
+  if len(sys.argv) < 2:
+    print(__doc__)
+    sys.exit(1)
+  s2wasm = os.path.abspath(sys.argv[1])
+  workdir = sys.argv[2] if len(sys.argv) > 2 else tempfile.mkdtemp()
+  if not os.path.isdir(workdir):
+    os.makedirs(workdir)
+  with open(os.path.join(workdir, 'input.s'), 'w') as f:
+    f.write(INPUT)
+  failed = False
+  for level in sorted(EXPECTED):
+    wast = os.path.join(workdir, 'metered%s.wast' % level)
+    # s2wasm exits with an error if the metered module does not validate
+    subprocess.check_call([s2wasm, 'input.s', level, '--gas-metering', '--validate', 'wasm', '-o', wast],
+                          cwd=workdir)
+    with open(wast) as f:
+      actual = charges(f.read())
+    for name, expected in sorted(EXPECTED[level].items()):
+      if actual.get(name) != expected:
+        print('FAIL: %s charges %s with %s, expected %s' % (level, name, actual.get(name), expected))
+        failed = True
+  if failed:
+    sys.exit(1)
+  print('ok: the charges of %d functions at %d levels are as expected'
+        % (len(EXPECTED['-O0']), len(EXPECTED)))
+
+
+if __name__ == '__main__':
+  main()
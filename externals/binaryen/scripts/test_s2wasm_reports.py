@@ -0,0 +1,92 @@
+#! /usr/bin/env python
+
+'''
+Checks that the reports of cosio-s2wasm do not change its output: the
+binary and the text written with --opt-report, --size-report,
+--size-report-json or --pass-stats must be byte-identical to those
+written without. Measuring a binary assigns function types to the
+functions that lack one, which changes what the optimizer keeps (e.g.
+which of two duplicate functions) unless the module is put back after.
+
+It also checks that the parallel parse of function bodies does not
+change the output: an input with a few huge functions, whose bodies
+finish parsing well after those around them, must build the same with
+BINARYEN_CORES=1 and =4.
+
+Usage: test_s2wasm_reports.py path/to/cosio-s2wasm [WORKDIR]
+
+The input is a small synthetic .s from bench_s2wasm_input.py, which has
+functions without a declared type and duplicates among them, and one
+made with its huge functions.
+'''
+
+from __future__ import print_function
+
+import os
+import subprocess
+import sys
+import tempfile
+
+from bench_s2wasm_input import generate
+
+REPORTS = [
+  ['--opt-report'],
+  ['--size-report', '5'],
+  ['--size-report-json', 'sizes.json'],
+  ['--pass-stats', 'passes.json'],
+]
+
+
+CORES = ['1', '4']
+
+
+def build(s2wasm, workdir, name, flags, input='input.s', cores=None):
+  wasm = os.path.join(workdir, name + '.wasm')
+  wast = os.path.join(workdir, name + '.wast')
+  env = dict(os.environ)
+  if cores:
+    env['BINARYEN_CORES'] = cores
+  with open(os.devnull, 'w') as null:
+    subprocess.check_call([s2wasm, input, '-O2', '--emit-binary', '-o', wasm, '-t', wast] + flags,
+                          cwd=workdir, stderr=null, env=env)
+  outputs = []
+  for path in (wasm, wast):
+    with open(path, 'rb') as f:
+      outputs.append(f.read())
+  return outputs
+
+
+def main():
+  if len(sys.argv) < 2:
+    print(__doc__)
+    sys.exit(1)
+  s2wasm = os.path.abspath(sys.argv[1])
+  workdir = sys.argv[2] if len(sys.argv) > 2 else tempfile.mkdtemp()
+  if not os.path.isdir(workdir):
+    os.makedirs(workdir)
+  generate(os.path.join(workdir, 'input.s'), 1)
+  expected = build(s2wasm, workdir, 'plain', [])
+  failed = False
+  for flags in REPORTS:
+    actual = build(s2wasm, workdir, flags[0].lstrip('-'), flags)
+    for kind, a, b in zip(('binary', 'text'), expected, actual):
+      if a != b:
+        print('FAIL: %s changes the %s output (%d bytes, %d without)' % (' '.join(flags), kind, len(b), len(a)))
+        failed = True
+  generate(os.path.join(workdir, 'huge.s'), 1, huge=4)
+  expected = build(s2wasm, workdir, 'cores' + CORES[0], [], 'huge.s', CORES[0])
+  for cores in CORES[1:]:
+    actual = build(s2wasm, workdir, 'cores' + cores, [], 'huge.s', cores)
+    for kind, a, b in zip(('binary', 'text'), expected, actual):
+      if a != b:
+        print('FAIL: BINARYEN_CORES=%s changes the %s output (%d bytes, %d with %s)'
+              % (cores, kind, len(b), len(a), CORES[0]))
+        failed = True
+  if failed:
+    sys.exit(1)
+  print('ok: %d reports leave the output unchanged' % len(REPORTS))
+  print('ok: the output is the same with BINARYEN_CORES=%s' % ', '.join(CORES))
+
+
+if __name__ == '__main__':
+  main()
@@ -70,9 +70,23 @@ struct MixedArena {
   // list of next, adding an allocator if necessary
   std::atomic<MixedArena*> next;
 
+  // the size of our chunks, readable from other threads
+  std::atomic<size_t> bytes;
+
   MixedArena() {
     threadId = std::this_thread::get_id();
     next.store(nullptr);
+    bytes.store(0);
+  }
+
+  // the memory held by this arena and the side arenas of other threads;
+  // nothing is freed before clear(), so this is also its peak so far
+  size_t totalBytes() {
+    size_t total = 0;
+    for (MixedArena* curr = this; curr; curr = curr->next.load()) {
+      total += curr->bytes.load(std::memory_order_relaxed);
+    }
+    return total;
   }
 
   void* allocSpace(size_t size) {
@@ -115,6 +129,7 @@ struct MixedArena {
     }
     if (chunks.size() == 0 || index + size >= chunkSize || mustAllocate) {
       chunks.push_back(new char[chunkSize]);
+      bytes.fetch_add(chunkSize, std::memory_order_relaxed);
       index = 0;
     }
     auto* ret = chunks.back() + index;
@@ -134,6 +149,7 @@ struct MixedArena {
       delete[] chunk;
     }
     chunks.clear();
+    bytes.store(0);
   }
 
   ~MixedArena() {
@@ -64,6 +64,40 @@ struct PassOptions {
   bool debugInfo = false; // whether to try to preserve debug info through, which are special calls
 };
 
+//
+// Where the time of a PassRunner went, for --pass-stats. Each pass, each
+// stack of function-parallel passes run together, and each chunk of
+// functions that a thread ran a stack on gets a sample. Sizes are in
+// expressions in function bodies, and in bytes of the module's arena.
+//
+struct PassStats {
+  struct Sample {
+    double wall = 0, cpu = 0; // seconds
+    size_t arenaBytes = 0;    // after it ran; arenas only grow, so also the peak
+    size_t nodesBefore = 0, nodesAfter = 0;
+  };
+  struct PassSample : public Sample {
+    std::string name;
+    Index stack = Index(-1); // the stack it ran in, if function-parallel
+  };
+  struct StackSample : public Sample {
+    std::vector<std::string> passes;
+  };
+  // the wall and CPU time of a chunk are those of its passes; start and end
+  // are from the start of the stack, and show how long a thread stalled
+  struct ChunkSample : public Sample {
+    Index stack = 0, thread = 0, functions = 0;
+    double start = 0, end = 0;
+  };
+
+  // passes of a stack sum the time spent in them by all threads
+  std::vector<PassSample> passes;
+  std::vector<StackSample> stacks;
+  std::vector<ChunkSample> chunks;
+
+  void writeJSON(std::ostream& o);
+};
+
 //
 // Runs a set of passes, in order
 //
@@ -83,6 +117,10 @@ struct PassRunner {
   void setValidateGlobally(bool validate) {
     options.validateGlobally = validate;
   }
+  // record statistics of the run into stats (not of nested runners)
+  void setStats(PassStats* stats_) {
+    stats = stats_;
+  }
 
   void add(std::string passName) {
     auto pass = PassRegistry::get()->createPass(passName);
@@ -105,14 +143,22 @@ struct PassRunner {
   void addDefaultOptimizationPasses();
 
   // Adds the default optimization passes that work on
-  // individual functions.
+  // individual functions. They are all function-parallel,
+  // so run() runs them as one stack; a pass that is not
+  // would split it in two, with a barrier in between.
   void addDefaultFunctionOptimizationPasses();
 
   // Adds the default optimization passes that work on
   // entire modules as a whole.
   void addDefaultGlobalOptimizationPasses();
 
-  // Run the passes on the module
+  // Run the passes on the module. Each run of consecutive
+  // function-parallel passes is fused into a stack: a thread runs
+  // the whole stack on one function before it takes the next, with
+  // no barrier between the passes. As such a pass only modifies
+  // the function it is given, the result is the same as running
+  // each pass on all functions in turn, which is what debug mode
+  // (and BINARYEN_PASS_DEBUG) does.
   void run();
 
   // Run the passes on a specific function
@@ -143,11 +189,13 @@ struct PassRunner {
 
 protected:
   bool isNested = false;
+  PassStats* stats = nullptr;
 
 private:
   void doAdd(Pass* pass);
 
   void runPassOnFunction(Pass* pass, Function* func);
+  void runPassWithStats(Pass* pass);
 };
 
 //
@@ -0,0 +1,193 @@
+//
+// Instruments the build to charge for execution, one basic block at a time.
+//
+// Each basic block is weighed with CostAnalyzer, and a call to an imported
+// gas_charge(i32) with the weight of the whole block is put where the block
+// starts: at function entry, at the top of loops and if arms, and after
+// ifs, loops, br_ifs and blocks that are branched to. The host can sum the
+// charges for profiling, and abort execution once a budget is exceeded.
+//
+// A block is charged in full when it is entered, so a trap in its middle
+// is charged as if the rest of the block ran.
+//
+
+#include <wasm.h>
+#include <wasm-builder.h>
+#include <pass.h>
+#include <cfg/cfg-traversal.h>
+#include <ast/cost.h>
+#include "shared-constants.h"
+#include "asmjs/shared-constants.h"
+#include "asm_v_wasm.h"
+
+namespace wasm {
+
+Name GAS_CHARGE("gas_charge");
+
+struct GasBlock {
+  Index cost = 0;
+  Expression** start = nullptr; // the block starts before this expression, or after it
+  bool after = false;
+};
+
+struct GasMetering : public WalkerPass<CFGWalker<GasMetering, UnifiedExpressionVisitor<GasMetering>, GasBlock>> {
+  typedef CFGWalker<GasMetering, UnifiedExpressionVisitor<GasMetering>, GasBlock> Super;
+
+  // only function bodies are metered; global initializers and segment
+  // offsets run once, when the module is instantiated
+  void doWalkModule(Module* module) {
+    for (auto& curr : module->functions) {
+      walkFunction(curr.get());
+    }
+  }
+
+  void visitModule(Module* curr) {
+    if (curr->getImportOrNull(GAS_CHARGE)) return;
+    auto import = new Import;
+    import->name = GAS_CHARGE;
+    import->module = ENV;
+    import->base = GAS_CHARGE;
+    import->functionType = ensureFunctionType("vi", curr)->name;
+    import->kind = ExternalKind::Function;
+    curr->addImport(import);
+  }
+
+  // An expression is weighed on its own, when it is visited after its
+  // children, by swapping its children for a nop while CostAnalyzer runs.
+  // The children are the slots scanned since the expression's frame began.
+
+  std::vector<Expression**> slots;
+  std::vector<size_t> frames;
+  Nop nop;
+
+  static void scan(GasMetering* self, Expression** currp) {
+    self->slots.push_back(currp);
+    Super::scan(self, currp);
+    self->pushTask(doStartExpression, currp);
+  }
+
+  static void doStartExpression(GasMetering* self, Expression** currp) {
+    self->frames.push_back(self->slots.size());
+  }
+
+  size_t endExpression() {
+    auto begin = frames.back();
+    frames.pop_back();
+    return begin;
+  }
+
+  void visitExpression(Expression* curr) {
+    auto begin = endExpression();
+    if (currBasicBlock) {
+      std::vector<Expression*> children;
+      for (auto i = begin; i < slots.size(); i++) {
+        children.push_back(*slots[i]);
+        *slots[i] = &nop;
+      }
+      currBasicBlock->contents.cost += CostAnalyzer(curr).cost;
+      for (auto i = begin; i < slots.size(); i++) {
+        *slots[i] = children[i - begin];
+      }
+    }
+    slots.resize(begin);
+  }
+
+  // ifs are not visited by the CFG walker. The test is charged to the
+  // block before the if.
+
+  static void doStartIfTrue(GasMetering* self, Expression** currp) {
+    auto* iff = (*currp)->cast<If>();
+    if (self->currBasicBlock) {
+      If test;
+      test.condition = test.ifTrue = &self->nop;
+      test.ifFalse = iff->ifFalse ? &self->nop : nullptr;
+      self->currBasicBlock->contents.cost += CostAnalyzer(&test).cost;
+    }
+    Super::doStartIfTrue(self, currp);
+    self->startAt(&iff->ifTrue, false);
+  }
+
+  static void doStartIfFalse(GasMetering* self, Expression** currp) {
+    Super::doStartIfFalse(self, currp);
+    self->startAt(&(*currp)->cast<If>()->ifFalse, false);
+  }
+
+  static void doEndIf(GasMetering* self, Expression** currp) {
+    self->slots.resize(self->endExpression());
+    Super::doEndIf(self, currp);
+    self->startAt(currp, true);
+  }
+
+  static void doStartLoop(GasMetering* self, Expression** currp) {
+    Super::doStartLoop(self, currp);
+    self->startAt(&(*currp)->cast<Loop>()->body, false);
+  }
+
+  static void doEndLoop(GasMetering* self, Expression** currp) {
+    Super::doEndLoop(self, currp);
+    self->startAt(currp, true);
+  }
+
+  static void doEndBlock(GasMetering* self, Expression** currp) {
+    auto* last = self->currBasicBlock;
+    Super::doEndBlock(self, currp);
+    if (self->currBasicBlock != last) {
+      self->startAt(currp, true);
+    }
+  }
+
+  static void doEndBreak(GasMetering* self, Expression** currp) {
+    Super::doEndBreak(self, currp);
+    self->startAt(currp, true);
+  }
+
+  void startAt(Expression** start, bool after) {
+    if (currBasicBlock) {
+      currBasicBlock->contents.start = start;
+      currBasicBlock->contents.after = after;
+    }
+  }
+
+  void doWalkFunction(Function* func) {
+    Super::doWalkFunction(func);
+    slots.clear();
+    entry->contents.start = &func->body;
+    entry->contents.after = false;
+    // two blocks may start at the same expression, one before and one after
+    // it; wrapping the expression keeps both in place, in either order
+    auto alive = findLiveBlocks();
+    for (auto& block : basicBlocks) {
+      if (!alive.count(block.get())) continue;
+      auto& contents = block->contents;
+      if (contents.cost > 0 && contents.start) {
+        charge(func, contents.start, contents.after, contents.cost);
+      }
+    }
+  }
+
+private:
+  void charge(Function* func, Expression** start, bool after, Index cost) {
+    Builder builder(*getModule());
+    auto* call = builder.makeCallImport(GAS_CHARGE, { builder.makeConst(Literal(int32_t(cost))) }, none);
+    auto* curr = *start;
+    if (!after) {
+      *start = builder.makeSequence(call, curr);
+    } else if (!isConcreteWasmType(curr->type)) {
+      *start = builder.makeSequence(curr, call);
+    } else {
+      // keep the value of the expression across the charge
+      auto index = Builder::addVar(func, curr->type);
+      auto* block = builder.makeBlock(builder.makeSetLocal(index, curr));
+      block->list.push_back(call);
+      block->list.push_back(builder.makeGetLocal(index, curr->type));
+      block->finalize(curr->type);
+      *start = block;
+    }
+  }
+};
+
+Pass *createGasMeteringPass() {
+  return new GasMetering();
+}
+
+} // namespace wasm
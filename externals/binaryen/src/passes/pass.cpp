@@ -14,7 +14,9 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <chrono>
+#include <ctime>
 #include <sstream>
 
 #include <support/colors.h>
@@ -75,6 +77,7 @@ void PassRegistry::registerPasses() {
   registerPass("legalize-js-interface", "legalizes i64 types on the import/export boundary", createLegalizeJSInterfacePass);
   registerPass("local-cse", "common subexpression elimination inside basic blocks", createLocalCSEPass);
   registerPass("log-execution", "instrument the build with logging of where execution goes", createLogExecutionPass);
+  registerPass("gas-metering", "instrument the build to charge the cost of each basic block to an imported gas_charge", createGasMeteringPass);
   registerPass("instrument-locals", "instrument the build with code to intercept all loads and stores", createInstrumentLocalsPass);
   registerPass("instrument-memory", "instrument the build with code to intercept all loads and stores", createInstrumentMemoryPass);
   registerPass("memory-packing", "packs memory into separate segments, skipping zeros", createMemoryPackingPass);
@@ -168,6 +171,197 @@ static void dumpWast(Name name, Module* wasm) {
   fclose(f);
 }
 
+// --pass-stats, and function sizes for the scheduler
+
+static double processCPUTime() {
+  return double(std::clock()) / CLOCKS_PER_SEC;
+}
+
+static double threadCPUTime() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+  return processCPUTime();
+#endif
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct NodeCounter : public PostWalker<NodeCounter, UnifiedExpressionVisitor<NodeCounter>> {
+  size_t count = 0;
+
+  void visitExpression(Expression* curr) {
+    count++;
+  }
+};
+
+static size_t countNodes(Function* func) {
+  NodeCounter counter;
+  counter.walk(func->body);
+  return counter.count;
+}
+
+static size_t countNodes(Module* wasm) {
+  size_t count = 0;
+  for (auto& func : wasm->functions) {
+    count += countNodes(func.get());
+  }
+  return count;
+}
+
+// The indexes of the functions of a module for a stack of function-parallel
+// passes, largest first, so that a few large functions are not left to run
+// last on an otherwise idle pool. Sizes are measured on the pool too; with a
+// single worker the order does not matter.
+static std::vector<size_t> functionsLargestFirst(Module* wasm, size_t num) {
+  size_t numFunctions = wasm->functions.size();
+  std::vector<size_t> order(numFunctions);
+  for (size_t i = 0; i < numFunctions; i++) {
+    order[i] = i;
+  }
+  if (num == 1) return order;
+  std::vector<size_t> sizes(numFunctions);
+  std::atomic<size_t> nextFunction;
+  nextFunction.store(0);
+  std::vector<std::function<ThreadWorkState ()>> doWorkers;
+  for (size_t i = 0; i < num; i++) {
+    doWorkers.push_back([&]() {
+      auto index = nextFunction.fetch_add(1);
+      if (index >= numFunctions) {
+        return ThreadWorkState::Finished;
+      }
+      sizes[index] = countNodes(wasm->functions[index].get());
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return sizes[a] > sizes[b];
+  });
+  return order;
+}
+
+// Records the stats of a stack of function-parallel passes, with a chunk
+// per thread. Each thread only touches its own chunk and pass samples.
+struct StackStatsRecorder {
+  PassStats& stats;
+  Module* wasm;
+  std::vector<Pass*>& stack;
+  PassStats::StackSample sample;
+  std::vector<PassStats::ChunkSample> chunks;
+  std::vector<std::vector<PassStats::Sample>> passes; // per thread, per pass
+  std::chrono::steady_clock::time_point start;
+  double cpuStart;
+
+  StackStatsRecorder(PassStats& stats, Module* wasm, std::vector<Pass*>& stack, size_t threads)
+    : stats(stats), wasm(wasm), stack(stack), chunks(threads), passes(threads, std::vector<PassStats::Sample>(stack.size())) {
+    for (auto* pass : stack) {
+      sample.passes.push_back(pass->name);
+    }
+    sample.nodesBefore = countNodes(wasm);
+    start = std::chrono::steady_clock::now();
+    cpuStart = processCPUTime();
+  }
+
+  template<typename RunPass>
+  void runFunction(Index thread, Function* func, RunPass runPass) {
+    auto& chunk = chunks[thread];
+    if (chunk.functions++ == 0) {
+      chunk.start = secondsSince(start);
+    }
+    auto nodes = countNodes(func);
+    chunk.nodesBefore += nodes;
+    for (size_t i = 0; i < stack.size(); i++) {
+      auto& pass = passes[thread][i];
+      auto passStart = std::chrono::steady_clock::now();
+      auto passCPUStart = threadCPUTime();
+      runPass(stack[i]);
+      auto wall = secondsSince(passStart);
+      auto cpu = threadCPUTime() - passCPUStart;
+      pass.wall += wall;
+      pass.cpu += cpu;
+      chunk.wall += wall;
+      chunk.cpu += cpu;
+      pass.nodesBefore += nodes;
+      nodes = countNodes(func);
+      pass.nodesAfter += nodes;
+    }
+    chunk.nodesAfter += nodes;
+    chunk.arenaBytes = wasm->allocator.totalBytes();
+    chunk.end = secondsSince(start);
+  }
+
+  void finish() {
+    sample.wall = secondsSince(start);
+    sample.cpu = processCPUTime() - cpuStart;
+    sample.arenaBytes = wasm->allocator.totalBytes();
+    sample.nodesAfter = countNodes(wasm);
+    Index index = stats.stacks.size();
+    for (size_t i = 0; i < stack.size(); i++) {
+      PassStats::PassSample pass;
+      pass.name = stack[i]->name;
+      pass.stack = index;
+      pass.arenaBytes = sample.arenaBytes;
+      for (auto& perThread : passes) {
+        pass.wall += perThread[i].wall;
+        pass.cpu += perThread[i].cpu;
+        pass.nodesBefore += perThread[i].nodesBefore;
+        pass.nodesAfter += perThread[i].nodesAfter;
+      }
+      stats.passes.push_back(pass);
+    }
+    for (Index i = 0; i < chunks.size(); i++) {
+      if (chunks[i].functions == 0) continue;
+      chunks[i].stack = index;
+      chunks[i].thread = i;
+      stats.chunks.push_back(chunks[i]);
+    }
+    stats.stacks.push_back(sample);
+  }
+};
+
+void PassStats::writeJSON(std::ostream& o) {
+  auto fields = [&o](const Sample& s) {
+    o << "\"wall\": " << s.wall << ", \"cpu\": " << s.cpu << ", \"arena_bytes\": " << s.arenaBytes
+      << ", \"nodes_before\": " << s.nodesBefore << ", \"nodes_after\": " << s.nodesAfter;
+  };
+  o << "{\n  \"passes\": [";
+  bool first = true;
+  for (auto& p : passes) {
+    o << (first ? "\n    " : ",\n    ") << "{\"name\": \"" << p.name << "\", ";
+    if (p.stack != Index(-1)) o << "\"stack\": " << p.stack << ", ";
+    fields(p);
+    o << "}";
+    first = false;
+  }
+  o << "\n  ],\n  \"stacks\": [";
+  first = true;
+  for (auto& s : stacks) {
+    o << (first ? "\n    " : ",\n    ") << "{\"passes\": [";
+    for (size_t i = 0; i < s.passes.size(); i++) {
+      o << (i ? ", \"" : "\"") << s.passes[i] << "\"";
+    }
+    o << "], ";
+    fields(s);
+    o << "}";
+    first = false;
+  }
+  o << "\n  ],\n  \"chunks\": [";
+  first = true;
+  for (auto& c : chunks) {
+    o << (first ? "\n    " : ",\n    ") << "{\"stack\": " << c.stack << ", \"thread\": " << c.thread
+      << ", \"functions\": " << c.functions << ", \"start\": " << c.start << ", \"end\": " << c.end << ", ";
+    fields(c);
+    o << "}";
+    first = false;
+  }
+  o << "\n  ]\n}\n";
+}
+
 void PassRunner::run() {
   static const int passDebug = getPassDebug();
   if (!isNested && (options.debug || passDebug)) {
@@ -193,7 +387,9 @@ void PassRunner::run() {
         std::cerr << ' ';
       }
       auto before = std::chrono::steady_clock::now();
-      if (pass->isFunctionParallel()) {
+      if (stats) {
+        runPassWithStats(pass);
+      } else if (pass->isFunctionParallel()) {
         // function-parallel passes should get a new instance per function
         for (auto& func : wasm->functions) {
           runPassOnFunction(pass, func.get());
@@ -235,28 +431,36 @@ void PassRunner::run() {
         // run the stack of passes on all the functions, in parallel
         size_t num = ThreadPool::get()->size();
         std::vector<std::function<ThreadWorkState ()>> doWorkers;
-        std::atomic<size_t> nextFunction;
-        nextFunction.store(0);
-        size_t numFunctions = wasm->functions.size();
+        std::unique_ptr<StackStatsRecorder> recorder;
+        if (stats) {
+          recorder = make_unique<StackStatsRecorder>(*stats, wasm, stack, num);
+        }
+        WorkQueues queues(num, functionsLargestFirst(wasm, num));
         for (size_t i = 0; i < num; i++) {
-          doWorkers.push_back([&]() {
-            auto index = nextFunction.fetch_add(1);
+          doWorkers.push_back([&, i]() {
+            size_t index;
             // get the next task, if there is one
-            if (index >= numFunctions) {
+            if (!queues.getTask(i, index)) {
               return ThreadWorkState::Finished; // nothing left
             }
             Function* func = this->wasm->functions[index].get();
             // do the current task: run all passes on this function
-            for (auto* pass : stack) {
-              runPassOnFunction(pass, func);
-            }
-            if (index + 1 == numFunctions) {
-              return ThreadWorkState::Finished; // we did the last one
+            if (recorder) {
+              recorder->runFunction(i, func, [&](Pass* pass) {
+                runPassOnFunction(pass, func);
+              });
+            } else {
+              for (auto* pass : stack) {
+                runPassOnFunction(pass, func);
+              }
             }
             return ThreadWorkState::More;
           });
         }
         ThreadPool::get()->work(doWorkers);
+        if (recorder) {
+          recorder->finish();
+        }
       }
       stack.clear();
     };
@@ -265,7 +469,11 @@ void PassRunner::run() {
         stack.push_back(pass);
       } else {
         flush();
-        pass->run(this, wasm);
+        if (stats) {
+          runPassWithStats(pass);
+        } else {
+          pass->run(this, wasm);
+        }
       }
     }
     flush();
@@ -299,6 +507,26 @@ void PassRunner::runPassOnFunction(Pass* pass, Function* func) {
   instance->runFunction(this, wasm, func);
 }
 
+void PassRunner::runPassWithStats(Pass* pass) {
+  PassStats::PassSample sample;
+  sample.name = pass->name;
+  sample.nodesBefore = countNodes(wasm);
+  auto start = std::chrono::steady_clock::now();
+  auto cpuStart = processCPUTime();
+  if (pass->isFunctionParallel()) {
+    for (auto& func : wasm->functions) {
+      runPassOnFunction(pass, func.get());
+    }
+  } else {
+    pass->run(this, wasm);
+  }
+  sample.wall = secondsSince(start);
+  sample.cpu = processCPUTime() - cpuStart;
+  sample.arenaBytes = wasm->allocator.totalBytes();
+  sample.nodesAfter = countNodes(wasm);
+  stats->passes.push_back(sample);
+}
+
 int PassRunner::getPassDebug() {
   static const int passDebug = getenv("BINARYEN_PASS_DEBUG") ? atoi(getenv("BINARYEN_PASS_DEBUG")) : 0;
   return passDebug;
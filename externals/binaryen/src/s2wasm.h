@@ -21,6 +21,7 @@
 #ifndef wasm_s2wasm_h
 #define wasm_s2wasm_h
 
+#include <exception>
 #include <limits.h>
 
 #include "wasm.h"
@@ -29,6 +30,7 @@
 #include "asm_v_wasm.h"
 #include "wasm-builder.h"
 #include "wasm-linker.h"
+#include "support/threads.h"
 
 namespace wasm {
 
@@ -45,6 +47,34 @@ class S2WasmBuilder {
   LinkerObject* linkerObj;
   std::unique_ptr<LinkerObject::SymbolInfo> symbolInfo;
   std::unordered_map<uint32_t, uint32_t> fileIndexMap;
+  std::string token; // reused by internToken
+
+  // A function body parsed ahead of process(), with the updates to the
+  // module and the linker object that parsing it makes, to be applied when
+  // process() gets to it. See parseFunctionsInParallel.
+  struct ParsedFunction {
+    std::unique_ptr<Function> func;
+    const char* end = nullptr; // where process() resumes after the function
+    std::vector<std::pair<Name, Address>> indirectIndexes;
+    std::vector<std::string> functionTypes; // signatures of call_indirects
+    std::vector<std::unique_ptr<LinkerObject::Relocation>> relocations;
+    std::vector<Call*> undefinedFunctionCalls;
+    std::exception_ptr error;
+  };
+  // by where parseFunction starts on them
+  std::unordered_map<const char*, std::unique_ptr<ParsedFunction>> parsedFunctions;
+  // set on a builder that parses one function body ahead of time
+  ParsedFunction* deferred = nullptr;
+
+  S2WasmBuilder(S2WasmBuilder& parent, const char* start, ParsedFunction* deferred)
+      : inputStart(start),
+        s(start),
+        debug(false),
+        wasm(parent.wasm),
+        allocator(parent.allocator),
+        linkerObj(parent.linkerObj),
+        deferred(deferred)
+        {}
 
  public:
   S2WasmBuilder(const char* input, bool debug)
@@ -64,8 +94,10 @@ class S2WasmBuilder {
     wasm = &obj->wasm;
     allocator = &wasm->allocator;
 
+    parseFunctionsInParallel();
     s = inputStart;
     process();
+    parsedFunctions.clear();
   }
 
   // getSymbolInfo scans the .s file to determine what symbols it defines
@@ -151,13 +183,18 @@ class S2WasmBuilder {
     s -= strlen(str.str);
   }
 
+  // Interns the input from start to s. The input is not NUL-terminated
+  // there, so the token is copied into a buffer first; IString copies it
+  // again only if it is new.
+  Name internToken(const char* start) {
+    token.assign(start, s - start);
+    return cashew::IString(token.c_str(), false);
+  }
+
   Name getStr() {
-    std::string str; // TODO: optimize this and the other get* methods
-    while (*s && !isspace(*s)) {
-      str += *s;
-      s++;
-    }
-    return cashew::IString(str.c_str(), false);
+    const char* start = s;
+    while (*s && !isspace(*s)) s++;
+    return internToken(start);
   }
 
   void skipToSep() {
@@ -167,21 +204,17 @@ class S2WasmBuilder {
   }
 
   Name getStrToSep() {
-    std::string str;
+    const char* start = s;
     while (*s && !isspace(*s) && *s != ',' && *s != '(' && *s != ')' && *s != ':' && *s != '+' && *s != '-' && *s != '=') {
-      str += *s;
       s++;
     }
-    return cashew::IString(str.c_str(), false);
+    return internToken(start);
   }
 
   Name getStrToColon() {
-    std::string str;
-    while (*s && !isspace(*s) && *s != ':') {
-      str += *s;
-      s++;
-    }
-    return cashew::IString(str.c_str(), false);
+    const char* start = s;
+    while (*s && !isspace(*s) && *s != ':') s++;
+    return internToken(start);
   }
 
   // get an int
@@ -288,7 +321,7 @@ class S2WasmBuilder {
       return nullptr;
     }
     if (linkerObj->isObjectImplemented(relocation->symbol)) {
-      linkerObj->addRelocation(relocation.release());
+      addRelocation(relocation.release());
       return nullptr;
     }
     return relocationToGetGlobal(relocation.get());
@@ -329,13 +362,11 @@ class S2WasmBuilder {
 
   Name getSeparated(char separator) {
     skipWhitespace();
-    std::string str;
-    while (*s && *s != separator && *s != '\n') {
-      str += *s;
-      s++;
-    }
+    const char* start = s;
+    while (*s && *s != separator && *s != '\n') s++;
+    Name ret = internToken(start);
     skipWhitespace();
-    return cashew::IString(str.c_str(), false);
+    return ret;
   }
   Name getCommaSeparated() { return getSeparated(','); }
   Name getAtSeparated() { return getSeparated('@'); }
@@ -345,24 +376,28 @@ class S2WasmBuilder {
     if (*s != '$') return Name();
     const char *before = s;
     s++;
-    std::string str;
-    while (*s && *s != '=' && *s != '\n' && *s != ',') {
-      str += *s;
-      s++;
-    }
+    const char* start = s;
+    while (*s && *s != '=' && *s != '\n' && *s != ',') s++;
     if (*s != '=') { // not an assign
       s = before;
       return Name();
     }
+    Name ret = internToken(start);
     s++;
     skipComma();
-    return cashew::IString(str.c_str(), false);
+    return ret;
   }
 
   std::vector<char> getQuoted() {
+    std::vector<char> str;
+    getQuoted(str);
+    return str;
+  }
+
+  // appends the unescaped string to str
+  void getQuoted(std::vector<char>& str) {
     ASSERT_THROW(*s == '"');
     s++;
-    std::vector<char> str;
     while (*s && *s != '\"') {
       if (s[0] == '\\') {
         switch (s[1]) {
@@ -388,7 +423,6 @@ class S2WasmBuilder {
     }
     s++;
     skipWhitespace();
-    return str;
   }
 
   WasmType tryGetType() {
@@ -423,12 +457,10 @@ class S2WasmBuilder {
   }
   // Drop the @ and after it.
   Name cleanFunction(Name name) {
-    if (!strchr(name.str, '@')) return name;
-    char *temp = strdup(name.str);
-    *strchr(temp, '@') = 0;
-    Name ret = cashew::IString(temp, false);
-    free(temp);
-    return ret;
+    const char* at = strchr(name.str, '@');
+    if (!at) return name;
+    token.assign(name.str, at - name.str);
+    return cashew::IString(token.c_str(), false);
   }
 
   // processors
@@ -732,7 +764,7 @@ class S2WasmBuilder {
         if (indirectIndex < 0) {
           abort_on("indidx");
         }
-        linkerObj->addIndirectIndex(name, indirectIndex);
+        addIndirectIndex(name, indirectIndex);
       } else if (match(".local")) {
         while (1) {
           Name name = getNextId();
@@ -981,9 +1013,8 @@ class S2WasmBuilder {
         auto inputs = getInputs(num);
         auto* target = *(inputs.end() - 1);
         std::vector<Expression*> operands(inputs.begin(), inputs.end() - 1);
-        auto* funcType = ensureFunctionType(getSig(type, operands), wasm);
-        ASSERT_THROW(type == funcType->result);
-        auto* indirect = builder.makeCallIndirect(funcType, target, std::move(operands));
+        auto fullType = functionTypeFor(getSig(type, operands));
+        auto* indirect = builder.makeCallIndirect(fullType, target, std::move(operands), type);
         setOutput(indirect, assign);
       } else {
         // non-indirect call
@@ -1005,7 +1036,7 @@ class S2WasmBuilder {
             LinkerObject::Relocation::kFunction);
         curr->target = target;
         if (!linkerObj->isFunctionImplemented(target)) {
-          linkerObj->addUndefinedFunctionCall(curr);
+          addUndefinedFunctionCall(curr);
         }
         setOutput(curr, assign);
       }
@@ -1310,7 +1341,151 @@ class S2WasmBuilder {
     ASSERT_THROW(bstack.empty());
     ASSERT_THROW(estack.empty());
     func->body->cast<Block>()->finalize();
-    wasm->addFunction(func);
+    if (deferred) {
+      deferred->func.reset(func);
+    } else {
+      wasm->addFunction(func);
+    }
+  }
+
+  // Updates made while parsing a function body, which a body parsed ahead of
+  // time records instead.
+
+  void addIndirectIndex(Name name, Address index) {
+    if (deferred) {
+      deferred->indirectIndexes.emplace_back(name, index);
+    } else {
+      linkerObj->addIndirectIndex(name, index);
+    }
+  }
+
+  void addRelocation(LinkerObject::Relocation* relocation) {
+    if (deferred) {
+      deferred->relocations.emplace_back(relocation);
+    } else {
+      linkerObj->addRelocation(relocation);
+    }
+  }
+
+  void addUndefinedFunctionCall(Call* call) {
+    if (deferred) {
+      deferred->undefinedFunctionCalls.push_back(call);
+    } else {
+      linkerObj->addUndefinedFunctionCall(call);
+    }
+  }
+
+  // ensureFunctionType names a type after its signature, so the name is
+  // known before the type is added.
+  Name functionTypeFor(const std::string& sig) {
+    if (deferred) {
+      deferred->functionTypes.push_back(sig);
+      return cashew::IString(("FUNCSIG$" + sig).c_str(), false);
+    }
+    return ensureFunctionType(sig, wasm)->name;
+  }
+
+  // Function bodies are most of a linked contract. Parsing one depends on
+  // nothing process() builds up before it but the file numbers of debug info,
+  // so bodies without .file and .loc directives are parsed first, on the
+  // thread pool, each into a ParsedFunction. process() then takes over each
+  // one where it would have parsed it and applies its updates in the same
+  // order as a sequential parse, which keeps the output identical.
+  // Expressions are allocated on the worker threads, which the module's
+  // MixedArena serves from a side arena per thread.
+  void parseFunctionsInParallel() {
+    if (debug || ThreadPool::get()->size() == 1) return;
+    std::vector<const char*> starts;
+    findFunctionBodies(starts);
+    if (starts.size() < 2) return;
+
+    std::vector<std::unique_ptr<ParsedFunction>> parsed(starts.size());
+    std::atomic<size_t> nextFunction;
+    nextFunction.store(0);
+    size_t num = ThreadPool::get()->size();
+    std::vector<std::function<ThreadWorkState ()>> doWorkers;
+    for (size_t i = 0; i < num; i++) {
+      doWorkers.push_back([&]() {
+        auto index = nextFunction.fetch_add(1);
+        if (index >= starts.size()) {
+          return ThreadWorkState::Finished;
+        }
+        auto curr = make_unique<ParsedFunction>();
+        S2WasmBuilder body(*this, starts[index], curr.get());
+        try {
+          body.parseFunction();
+          curr->end = body.s;
+        } catch (...) {
+          // rethrown when process() gets to the function
+          curr->error = std::current_exception();
+        }
+        parsed[index] = std::move(curr);
+        return ThreadWorkState::More;
+      });
+    }
+    ThreadPool::get()->work(doWorkers);
+    for (size_t i = 0; i < starts.size(); i++) {
+      parsedFunctions[starts[i]] = std::move(parsed[i]);
+    }
+  }
+
+  // Finds where parseType starts parsing each function body, line by line.
+  void findFunctionBodies(std::vector<const char*>& starts) {
+    s = inputStart;
+    while (*s) {
+      skipWhitespace();
+      if (match(".type")) {
+        Name name = getStrToSep();
+        skipComma();
+        if (match("@function") && (!match(".hidden") || match(name.str))) {
+          size_t size = strlen(name.str);
+          if (!strncmp(s, name.str, size) && s[size] == ':') {
+            const char* start = s;
+            if (skipFunctionBody()) starts.push_back(start);
+            continue;
+          }
+        }
+      }
+      skipLine();
+    }
+  }
+
+  // Skips to the line that ends the function body for parseFunction, and
+  // returns whether there is one and the body has no debug info.
+  bool skipFunctionBody() {
+    bool debugInfo = false;
+    while (*s) {
+      skipWhitespace();
+      if (peek(".Lfunc_end") || peek(".endfunc")) return !debugInfo;
+      if ((peek(".file") && isspace(s[5])) || (peek(".loc") && isspace(s[4]))) {
+        debugInfo = true;
+      }
+      skipLine();
+    }
+    return false;
+  }
+
+  void skipLine() {
+    const char* next = strchr(s, '\n');
+    s = next ? next : s + strlen(s);
+  }
+
+  void applyParsedFunction(ParsedFunction& parsed) {
+    if (parsed.error) std::rethrow_exception(parsed.error);
+    for (auto& index : parsed.indirectIndexes) {
+      linkerObj->addIndirectIndex(index.first, index.second);
+    }
+    for (auto& sig : parsed.functionTypes) {
+      ensureFunctionType(sig, wasm);
+    }
+    for (auto& relocation : parsed.relocations) {
+      linkerObj->addRelocation(relocation.release());
+    }
+    for (auto* call : parsed.undefinedFunctionCalls) {
+      linkerObj->addUndefinedFunctionCall(call);
+    }
+    wasm->addFunction(parsed.func.release());
+    s = parsed.end;
   }
 
   void parseType() {
@@ -1319,6 +1494,10 @@ class S2WasmBuilder {
     skipComma();
     if (match("@function")) {
       if (match(".hidden")) mustMatch(name.str);
+      auto parsed = parsedFunctions.find(s);
+      if (parsed != parsedFunctions.end()) {
+        return applyParsedFunction(*parsed->second);
+      }
       return parseFunction();
     } else if (match("@object")) {
       return parseObject(name);
@@ -1365,8 +1544,7 @@ class S2WasmBuilder {
           mustMatch("z");
           z = true;
         }
-        auto quoted = getQuoted();
-        raw.insert(raw.end(), quoted.begin(), quoted.end());
+        getQuoted(raw);
         if (z) raw.push_back(0);
         zero = false;
       } else if (match(".zero") || match(".skip")) {
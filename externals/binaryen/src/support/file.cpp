@@ -21,6 +21,16 @@
 #include <cstdint>
 #include <limits>
 
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define WASM_MMAP 1
+#endif
+
 template <typename T>
 T wasm::read_file(const std::string &filename, Flags::BinaryOption binary, Flags::DebugOption debug) {
   if (debug == Flags::Debug) std::cerr << "Loading '" << filename << "'..." << std::endl;
@@ -49,6 +59,61 @@ T wasm::read_file(const std::string &filename, Flags::BinaryOption binary, Flags
 template std::string wasm::read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 template std::vector<char> wasm::read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 
+wasm::MappedFile::MappedFile(const std::string &filename, Flags::DebugOption debug) {
+#if WASM_MMAP
+  int fd = filename == "-" ? dup(STDIN_FILENO) : open(filename.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd >= 0 && fstat(fd, &st) == 0 && !S_ISREG(st.st_mode)) {
+    // a pipe: read it as the writer produces it, without waiting for a size
+    if (debug == Flags::Debug) std::cerr << "Streaming '" << filename << "'..." << std::endl;
+    char buffer[1 << 16];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        std::cerr << "Failed reading '" << filename << "': " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      contents.append(buffer, n);
+    }
+    close(fd);
+    begin = contents.c_str();
+    length = contents.size();
+    return;
+  }
+  if (fd >= 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    if (debug == Flags::Debug) std::cerr << "Mapping '" << filename << "'..." << std::endl;
+    // the file goes over an anonymous mapping one page longer, whose zeros
+    // terminate it even when it ends on a page boundary
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = st.st_size;
+    size_t total = (size + page) / page * page;
+    void* base = mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base != MAP_FAILED) {
+      if (mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+        madvise(base, size, MADV_WILLNEED);
+        begin = static_cast<const char*>(base);
+        length = size;
+        mapped = total;
+        close(fd);
+        return;
+      }
+      munmap(base, total);
+    }
+  }
+  if (fd >= 0) close(fd);
+#endif
+  contents = read_file<std::string>(filename, Flags::Text, debug);
+  begin = contents.c_str();
+  length = contents.size() - 1; // read_file adds the '\0'
+}
+
+wasm::MappedFile::~MappedFile() {
+#if WASM_MMAP
+  if (mapped) munmap(const_cast<char*>(begin), mapped);
+#endif
+}
+
 wasm::Output::Output(const std::string &filename, Flags::BinaryOption binary, Flags::DebugOption debug)
     : outfile(), out([this, filename, binary, debug]() {
         std::streambuf *buffer;
@@ -45,6 +45,31 @@ T read_file(const std::string &filename, Flags::BinaryOption binary, Flags::Debu
 extern template std::string read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 extern template std::vector<char> read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 
+// A text file mapped read-only into memory, followed by a '\0' so that it
+// can be scanned as a C string, without copying it into a buffer first.
+// Where it cannot be mapped, it is read instead. A pipe, or "-" for stdin,
+// is read as the data arrives.
+class MappedFile {
+ public:
+  MappedFile(const std::string &filename, Flags::DebugOption debug);
+  ~MappedFile();
+
+  const char* data() const {
+    return begin;
+  }
+  size_t size() const {
+    return length;
+  }
+
+ private:
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  const char* begin = nullptr;
+  size_t length = 0;
+  size_t mapped = 0;
+  std::string contents; // when read
+};
+
 class Output {
  public:
   // An empty filename will open stdout instead.
@@ -193,5 +193,42 @@ bool ThreadPool::areThreadsReady() {
   return ready.load() == threads.size();
 }
 
+
+// WorkQueues
+
+WorkQueues::WorkQueues(size_t workers, const std::vector<size_t>& tasks) {
+  ASSERT_THROW(workers > 0);
+  for (size_t i = 0; i < workers; i++) {
+    queues.emplace_back(make_unique<Queue>());
+  }
+  for (size_t i = 0; i < tasks.size(); i++) {
+    queues[i % workers]->tasks.push_back(tasks[i]);
+  }
+}
+
+bool WorkQueues::getTask(size_t worker, size_t& task) {
+  {
+    auto& own = *queues[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.front();
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+  // nothing is ever added, so once every other deque was seen empty, all are
+  for (size_t i = 1; i < queues.size(); i++) {
+    auto& victim = *queues[(worker + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+      DEBUG_THREAD("stole task " << task << "\n");
+      return true;
+    }
+  }
+  return false;
+}
+
 } // namespace wasm
 
@@ -23,6 +23,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -106,6 +107,29 @@ private:
   bool areThreadsReady();
 };
 
+//
+// Work-stealing queues of tasks for the workers of a pool.
+//
+// Tasks are dealt round robin, in the order given, to a deque per worker. A
+// worker takes tasks from the front of its own deque, and once that is empty,
+// steals from the back of another's. With the tasks ordered largest first,
+// every worker starts on a large one, and the small ones even out the end.
+//
+
+class WorkQueues {
+  struct Queue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+  std::vector<std::unique_ptr<Queue>> queues;
+
+public:
+  WorkQueues(size_t workers, const std::vector<size_t>& tasks);
+
+  // Get the next task for a worker. Returns false when none are left.
+  bool getTask(size_t worker, size_t& task);
+};
+
 // Verify a code segment is only entered once. Usage:
 //    static OnlyOnce onlyOnce;
 //    onlyOnce.verify();
@@ -25,6 +25,8 @@ struct OptimizationOptions : public Options {
 
   std::vector<std::string> passes;
   PassOptions passOptions;
+  std::string passStatsFile;
+  PassStats passStats;
 
   OptimizationOptions(const std::string &command, const std::string &description) : Options(command, description) {
     (*this).add("", "-O", "execute default optimization passes",
@@ -89,6 +91,11 @@ struct OptimizationOptions : public Options {
                 Options::Arguments::Zero,
                 [this](Options*, const std::string&) {
                   passOptions.ignoreImplicitTraps = true;
+                })
+           .add("--pass-stats", "", "Write the wall and CPU time, arena memory and IR size of each pass, and of each thread's chunk of function-parallel passes, to this JSON file",
+                Options::Arguments::One,
+                [this](Options*, const std::string& argument) {
+                  passStatsFile = argument;
                 });
     // add passes in registry
     for (const auto& p : PassRegistry::get()->getRegisteredNames()) {
@@ -118,6 +125,7 @@ struct OptimizationOptions : public Options {
   PassRunner getPassRunner(Module& wasm) {
     PassRunner passRunner(&wasm, passOptions);
     if (debug) passRunner.setDebug(true);
+    if (!passStatsFile.empty()) passRunner.setStats(&passStats);
     for (auto& pass : passes) {
       if (pass == DEFAULT_OPT_PASSES) {
         passRunner.addDefaultOptimizationPasses();
@@ -127,6 +135,12 @@ struct OptimizationOptions : public Options {
     }
     return passRunner;
   }
+
+  void writePassStats() {
+    if (passStatsFile.empty()) return;
+    Output output(passStatsFile, Flags::Text, Flags::Release);
+    passStats.writeJSON(output.getStream());
+  }
 };
 
 } // namespace wasm
@@ -18,26 +18,233 @@
 // wasm2asm console tool
 //
 
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+
 #include "support/colors.h"
 #include "support/command-line.h"
 #include "support/file.h"
+#include "ast_utils.h"
+#include "ast/cost.h"
+#include "pass.h"
 #include "s2wasm.h"
+#include "wasm-binary.h"
 #include "wasm-emscripten.h"
+#include "wasm-io.h"
 #include "wasm-linker.h"
 #include "wasm-printing.h"
 #include "wasm-validator.h"
+#include "optimization-options.h"
 
 using namespace cashew;
 using namespace wasm;
 
+// The size of the binary encoding of a module, and optionally of each of
+// its function bodies. Writing the binary assigns function types to the
+// functions that lack one, which would change what later passes see (e.g.
+// which of two duplicate functions is kept) and the text output, so the
+// module is put back as it was afterwards.
+static size_t measureBinary(Module& wasm, std::vector<size_t>* functionSizes = nullptr) {
+  std::vector<Function*> untyped;
+  for (auto& func : wasm.functions) {
+    if (func->type.isNull()) untyped.push_back(func.get());
+  }
+  size_t numTypes = wasm.functionTypes.size();
+  size_t bytes;
+  {
+    BufferWithRandomAccess buffer(false);
+    WasmBinaryWriter writer(&wasm, buffer, false);
+    writer.setNamesSection(false);
+    writer.setFunctionSizes(functionSizes);
+    writer.write();
+    bytes = buffer.size();
+  }
+  for (auto* func : untyped) {
+    func->type = Name();
+  }
+  while (wasm.functionTypes.size() > numTypes) {
+    wasm.removeFunctionType(wasm.functionTypes.back()->name);
+  }
+  return bytes;
+}
+
+// What a contract is charged for on chain: the bytes of its binary
+// encoding, and the number of instructions in its function bodies.
+struct ModuleCost {
+  size_t binaryBytes = 0;
+  size_t instructions = 0;
+
+  static ModuleCost measure(Module& wasm) {
+    ModuleCost cost;
+    cost.binaryBytes = measureBinary(wasm);
+    for (auto& func : wasm.functions) {
+      cost.instructions += Measurer::measure(func->body);
+    }
+    return cost;
+  }
+};
+
+// Where a function of a contract comes from, told by its symbol: Itanium
+// mangled names give the outermost namespace, and the C libraries do not
+// mangle. apply and the static initializers belong to the contract, and
+// the C allocator entry points of cosiolib.cpp (memory.h) to cosiolib. Any
+// other unmangled symbol is reported as libc, including extern "C"
+// functions the contract defines itself.
+static const char* functionOrigin(Name name) {
+  static const char* cosiolibSymbols[] = { "sbrk", "malloc", "calloc", "realloc", "free" };
+  std::string symbol = name.str;
+  auto startsWith = [&symbol](const char* prefix, size_t pos) {
+    return symbol.compare(pos, strlen(prefix), prefix) == 0;
+  };
+  if (startsWith("_ZN", 0)) {
+    auto pos = symbol.find_first_not_of("rVKRO", 3);
+    if (pos == std::string::npos) return "contract";
+    if (startsWith("St", pos)) return "libc++";
+    if (startsWith("5boost", pos)) return "boost";
+    if (startsWith("5cosio", pos)) return "cosiolib";
+    return "contract";
+  }
+  if (startsWith("_ZSt", 0) || startsWith("__cxa_", 0) || startsWith("__gxx_", 0)) return "libc++";
+  if (startsWith("_Z", 0) || startsWith("_GLOBAL__", 0) || startsWith("__cxx_global_", 0)) return "contract";
+  if (symbol == "apply") return "contract";
+  for (auto* cosiolib : cosiolibSymbols) {
+    if (symbol == cosiolib) return "cosiolib";
+  }
+  return "libc";
+}
+
+// The share of each function in the module: the bytes of its binary
+// encoding, its expression count, and its static CostAnalyzer cost.
+struct FunctionCost {
+  Name name;
+  const char* origin;
+  size_t binaryBytes;
+  size_t instructions;
+  size_t cost;
+
+  static std::vector<FunctionCost> measure(Module& wasm) {
+    std::vector<size_t> sizes;
+    measureBinary(wasm, &sizes);
+    std::vector<FunctionCost> costs;
+    for (size_t i = 0; i < wasm.functions.size(); i++) {
+      auto* func = wasm.functions[i].get();
+      costs.push_back({ func->name, functionOrigin(func->name), sizes[i],
+                        Measurer::measure(func->body), CostAnalyzer(func->body).cost });
+    }
+    return costs;
+  }
+};
+
+struct OriginCost {
+  size_t functions = 0, binaryBytes = 0, instructions = 0, cost = 0;
+
+  void add(const FunctionCost& f) {
+    functions++;
+    binaryBytes += f.binaryBytes;
+    instructions += f.instructions;
+    cost += f.cost;
+  }
+};
+
+static std::map<std::string, OriginCost> costsByOrigin(const std::vector<FunctionCost>& costs) {
+  std::map<std::string, OriginCost> origins;
+  for (auto& f : costs) origins[f.origin].add(f);
+  return origins;
+}
+
+static void printSizeReport(std::ostream& o, std::vector<FunctionCost> costs, size_t top, size_t moduleBytes) {
+  std::sort(costs.begin(), costs.end(), [](const FunctionCost& a, const FunctionCost& b) {
+    return a.binaryBytes != b.binaryBytes ? a.binaryBytes > b.binaryBytes : a.name < b.name;
+  });
+  o << "[s2wasm] size report: " << moduleBytes << " binary bytes, " << costs.size() << " functions\n";
+  o << std::setw(12) << "origin" << std::setw(11) << "functions" << std::setw(9) << "bytes"
+    << std::setw(14) << "instructions" << std::setw(9) << "cost" << '\n';
+  for (auto& kv : costsByOrigin(costs)) {
+    auto& c = kv.second;
+    o << std::setw(12) << kv.first << std::setw(11) << c.functions << std::setw(9) << c.binaryBytes
+      << std::setw(14) << c.instructions << std::setw(9) << c.cost << '\n';
+  }
+  top = std::min(top, costs.size());
+  if (top == 0) return;
+  o << "top " << top << " functions by size:\n";
+  o << std::setw(9) << "bytes" << std::setw(14) << "instructions" << std::setw(9) << "cost"
+    << std::setw(11) << "origin" << "  name\n";
+  for (size_t i = 0; i < top; i++) {
+    auto& f = costs[i];
+    o << std::setw(9) << f.binaryBytes << std::setw(14) << f.instructions << std::setw(9) << f.cost
+      << std::setw(11) << f.origin << "  " << f.name.str << '\n';
+  }
+}
+
+static void writeJSONString(std::ostream& o, const char* s) {
+  o << '"';
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') o << '\\';
+    o << *s;
+  }
+  o << '"';
+}
+
+// Functions are listed in module order, so that reports of two builds diff
+// line by line.
+static void writeSizeReportJSON(std::ostream& o, const std::vector<FunctionCost>& costs, size_t moduleBytes) {
+  auto fields = [&o](size_t binaryBytes, size_t instructions, size_t cost) {
+    o << "\"bytes\": " << binaryBytes << ", \"instructions\": " << instructions << ", \"cost\": " << cost;
+  };
+  o << "{\n  \"bytes\": " << moduleBytes << ",\n  \"origins\": {";
+  bool first = true;
+  for (auto& kv : costsByOrigin(costs)) {
+    auto& c = kv.second;
+    o << (first ? "\n    " : ",\n    ");
+    writeJSONString(o, kv.first.c_str());
+    o << ": {\"functions\": " << c.functions << ", ";
+    fields(c.binaryBytes, c.instructions, c.cost);
+    o << "}";
+    first = false;
+  }
+  o << "\n  },\n  \"functions\": [";
+  first = true;
+  for (auto& f : costs) {
+    o << (first ? "\n    " : ",\n    ") << "{\"name\": ";
+    writeJSONString(o, f.name.str);
+    o << ", \"origin\": \"" << f.origin << "\", ";
+    fields(f.binaryBytes, f.instructions, f.cost);
+    o << "}";
+    first = false;
+  }
+  o << "\n  ]\n}\n";
+}
+
+static std::string optimizationLevelName(OptimizationOptions& options) {
+  auto& passOptions = options.passOptions;
+  if (!options.runningDefaultOptimizationPasses()) return "custom passes";
+  if (passOptions.shrinkLevel >= 2) return "-Oz";
+  if (passOptions.shrinkLevel == 1) return "-Os";
+  return "-O" + std::to_string(passOptions.optimizeLevel);
+}
+
+static void printCostChange(std::ostream& o, const char* what, size_t before, size_t after) {
+  o << "  " << what << ": " << before << " => " << after;
+  if (before > 0) {
+    double change = 100.0 * (double(after) - double(before)) / double(before);
+    o << " (" << std::showpos << std::fixed << std::setprecision(1) << change << "%" << std::noshowpos << ")";
+  }
+  o << '\n';
+}
+
 int main(int argc, const char *argv[]) {
   bool ignoreUnknownSymbols = false;
   bool generateEmscriptenGlue = false;
   bool allowMemoryGrowth = false;
   bool importMemory = false;
+  bool optimizationReport = false;
+  bool sizeReport = false;
+  size_t sizeReportTop = 0;
+  bool emitBinary = false;
   std::string startFunction;
   std::vector<std::string> archiveLibraries;
-  Options options("s2wasm", "Link .s file into .wast");
+  OptimizationOptions options("s2wasm", "Link .s file (- for stdin) into .wast or .wasm");
   options.extra["validate"] = "wasm";
   options
       .add("--output", "-o", "Output file (stdout if not specified)",
@@ -46,6 +253,16 @@ int main(int argc, const char *argv[]) {
              o->extra["output"] = argument;
              Colors::disable();
            })
+      .add("--emit-binary", "-b", "Emit a binary .wasm to the output file instead of text",
+           Options::Arguments::Zero,
+           [&emitBinary](Options *, const std::string &) {
+             emitBinary = true;
+           })
+      .add("--text-output", "-t", "Also write the text form of the module to this file",
+           Options::Arguments::One,
+           [](Options *o, const std::string &argument) {
+             o->extra["text-output"] = argument;
+           })
       .add("--ignore-unknown", "", "Ignore unknown symbols",
            Options::Arguments::Zero,
            [&ignoreUnknownSymbols](Options *, const std::string &) {
@@ -96,6 +313,22 @@ int main(int argc, const char *argv[]) {
            [&archiveLibraries](Options *o, const std::string &argument) {
              archiveLibraries.push_back(argument);
            })
+      .add("--opt-report", "", "Print the binary size and instruction count before and after optimization",
+           Options::Arguments::Zero,
+           [&optimizationReport](Options *, const std::string &) {
+             optimizationReport = true;
+           })
+      .add("--size-report", "", "Print the binary bytes, instructions and cost of the output by origin library, and its N largest functions",
+           Options::Arguments::One,
+           [&sizeReport, &sizeReportTop](Options *, const std::string &argument) {
+             sizeReport = true;
+             sizeReportTop = std::stoul(argument);
+           })
+      .add("--size-report-json", "", "Write the size of every function of the output, and of every origin library, to this JSON file",
+           Options::Arguments::One,
+           [](Options *o, const std::string &argument) {
+             o->extra["size-report-json"] = argument;
+           })
       .add("--validate", "-v", "Control validation of the output module",
            Options::Arguments::One,
            [](Options *o, const std::string &argument) {
@@ -115,9 +348,17 @@ int main(int argc, const char *argv[]) {
     Fatal() << "Error: adding memory growth code without Emscripten glue. "
       "This doesn't do anything.\n";
   }
+  if (emitBinary) {
+    if (options.extra["output"].empty()) {
+      Fatal() << "Error: --emit-binary requires an output file.\n";
+    }
+    if (generateEmscriptenGlue) {
+      Fatal() << "Error: Emscripten glue metadata can only be emitted with text output.\n";
+    }
+  }
 
   auto debugFlag = options.debug ? Flags::Debug : Flags::Release;
-  auto input(read_file<std::string>(options.extra["infile"], Flags::Text, debugFlag));
+  MappedFile input(options.extra["infile"], debugFlag);
 
   if (options.debug) std::cerr << "Parsing and wasming..." << std::endl;
   uint64_t globalBase = options.extra.find("global-base") != options.extra.end()
@@ -141,7 +382,7 @@ int main(int argc, const char *argv[]) {
                 importMemory || generateEmscriptenGlue, ignoreUnknownSymbols, startFunction,
                 options.debug);
 
-  S2WasmBuilder mainbuilder(input.c_str(), options.debug);
+  S2WasmBuilder mainbuilder(input.data(), options.debug);
   linker.linkObject(mainbuilder);
 
   for (const auto& m : archiveLibraries) {
@@ -177,10 +418,57 @@ int main(int argc, const char *argv[]) {
     }
   }
 
-  if (options.debug) std::cerr << "Printing..." << std::endl;
-  Output output(options.extra["output"], Flags::Text, options.debug ? Flags::Debug : Flags::Release);
-  WasmPrinter::printModule(&linker.getOutput().wasm, output.getStream());
-  output << meta.str();
+  if (options.runningPasses()) {
+    Module& wasm = linker.getOutput().wasm;
+    ModuleCost before;
+    if (optimizationReport) before = ModuleCost::measure(wasm);
+    if (options.debug) std::cerr << "Optimizing..." << std::endl;
+    PassRunner passRunner = options.getPassRunner(wasm);
+    passRunner.run();
+    options.writePassStats();
+    if (options.extra["validate"] != "none" &&
+        !wasm::WasmValidator().validate(wasm, options.extra["validate"] == "web")) {
+      Fatal() << "Error: optimized module is not valid.\n";
+    }
+    if (optimizationReport) {
+      ModuleCost after = ModuleCost::measure(wasm);
+      std::cerr << "[s2wasm] " << optimizationLevelName(options) << '\n';
+      printCostChange(std::cerr, "binary bytes", before.binaryBytes, after.binaryBytes);
+      printCostChange(std::cerr, "instructions", before.instructions, after.instructions);
+    }
+  }
+
+  bool sizeReportJSON = options.extra.count("size-report-json") > 0;
+  if (sizeReport || sizeReportJSON) {
+    Module& wasm = linker.getOutput().wasm;
+    auto costs = FunctionCost::measure(wasm);
+    auto moduleBytes = ModuleCost::measure(wasm).binaryBytes;
+    if (sizeReport) printSizeReport(std::cerr, costs, sizeReportTop, moduleBytes);
+    if (sizeReportJSON) {
+      Output output(options.extra["size-report-json"], Flags::Text, Flags::Release);
+      writeSizeReportJSON(output.getStream(), costs, moduleBytes);
+    }
+  }
+
+  if (options.extra.count("text-output") > 0) {
+    if (options.debug) std::cerr << "Printing text..." << std::endl;
+    Output output(options.extra["text-output"], Flags::Text, options.debug ? Flags::Debug : Flags::Release);
+    WasmPrinter::printModule(&linker.getOutput().wasm, output.getStream());
+    output << meta.str();
+  }
+
+  if (emitBinary) {
+    if (options.debug) std::cerr << "Writing binary..." << std::endl;
+    ModuleWriter writer;
+    writer.setDebug(options.debug);
+    writer.setBinary(true);
+    writer.writeBinary(linker.getOutput().wasm, options.extra["output"]);
+  } else {
+    if (options.debug) std::cerr << "Printing..." << std::endl;
+    Output output(options.extra["output"], Flags::Text, options.debug ? Flags::Debug : Flags::Release);
+    WasmPrinter::printModule(&linker.getOutput().wasm, output.getStream());
+    output << meta.str();
+  }
 
   if (options.debug) std::cerr << "Done." << std::endl;
   return 0;
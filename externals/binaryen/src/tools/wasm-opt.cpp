@@ -154,6 +154,7 @@ int main(int argc, const char* argv[]) {
     if (options.debug) std::cerr << "running passes...\n";
     PassRunner passRunner = options.getPassRunner(wasm);
     passRunner.run();
+    options.writePassStats();
     ASSERT_THROW(WasmValidator().validate(wasm));
   }
 
@@ -541,6 +541,7 @@ class WasmBinaryWriter : public Visitor<WasmBinaryWriter, void> {
   std::ostream* sourceMap = nullptr;
   std::string sourceMapUrl;
   std::string symbolMap;
+  std::vector<size_t>* functionSizes = nullptr;
 
   MixedArena allocator;
 
@@ -556,10 +557,13 @@ public:
     sourceMapUrl = url;
   }
   void setSymbolMap(std::string set) { symbolMap = set; }
+  // receives the encoded size of each function, its size prefix included, in module order
+  void setFunctionSizes(std::vector<size_t>* set) { functionSizes = set; }
 
   void write();
   void writeHeader();
   int32_t writeU32LEBPlaceholder();
+  void finishU32LEBPlaceholder(int32_t start, uint32_t size);
   void writeResizableLimits(Address initial, Address maximum, bool hasMaximum);
   int32_t startSection(BinaryConsts::Section code);
   void finishSection(int32_t start);
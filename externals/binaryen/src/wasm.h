@@ -703,6 +703,7 @@ public:
 
   void addStart(const Name& s);
 
+  void removeFunctionType(Name name);
   void removeImport(Name name);
   void removeExport(Name name);
   // TODO: remove* for other elements
@@ -71,6 +71,24 @@ int32_t WasmBinaryWriter::writeU32LEBPlaceholder() {
   return ret;
 }
 
+// Backpatches a size field reserved by writeU32LEBPlaceholder. Unless
+// something recorded absolute offsets into the output (a source map or
+// pending buffers), the field is shrunk to its minimal LEB encoding, so
+// the output matches what other assemblers produce byte-for-byte.
+void WasmBinaryWriter::finishU32LEBPlaceholder(int32_t start, uint32_t size) {
+  if (sourceMap || !buffersToWrite.empty()) {
+    o.writeAt(start, U32LEB(size));
+    return;
+  }
+  BufferWithRandomAccess encoded(false);
+  encoded << U32LEB(size);
+  auto shrink = 5 - encoded.size();
+  std::copy(encoded.begin(), encoded.end(), o.begin() + start);
+  if (shrink > 0) {
+    o.erase(o.begin() + start + encoded.size(), o.begin() + start + 5);
+  }
+}
+
 void WasmBinaryWriter::writeResizableLimits(Address initial, Address maximum, bool hasMaximum) {
   uint32_t flags = hasMaximum ? 1 : 0;
   o << U32LEB(flags);
@@ -87,7 +105,7 @@ int32_t WasmBinaryWriter::startSection(BinaryConsts::Section code) {
 
 void WasmBinaryWriter::finishSection(int32_t start) {
   int32_t size = o.size() - start - 5; // section size does not include the 5 bytes of the size field itself
-  o.writeAt(start, U32LEB(size));
+  finishU32LEBPlaceholder(start, size);
 }
 
 int32_t WasmBinaryWriter::startSubsection(BinaryConsts::UserSections::Subsection code) {
@@ -97,7 +115,7 @@ int32_t WasmBinaryWriter::startSubsection(BinaryConsts::UserSections::Subsection
 
 void WasmBinaryWriter::finishSubsection(int32_t start) {
   int32_t size = o.size() - start - 5; // section size does not include the 5 bytes of the size field itself
-  o.writeAt(start, U32LEB(size));
+  finishU32LEBPlaceholder(start, size);
 }
 
 void WasmBinaryWriter::writeStart() {
@@ -264,7 +282,8 @@ void WasmBinaryWriter::writeFunctions() {
     size_t size = o.size() - start;
     ASSERT_THROW(size <= std::numeric_limits<uint32_t>::max());
     if (debug) std::cerr << "body size: " << size << ", writing at " << sizePos << ", next starts at " << o.size() << std::endl;
-    o.writeAt(sizePos, U32LEB(size));
+    finishU32LEBPlaceholder(sizePos, size);
+    if (functionSizes) functionSizes->push_back(o.size() - sizePos);
   }
   currFunction = nullptr;
   finishSection(start);
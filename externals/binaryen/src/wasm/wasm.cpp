@@ -654,6 +654,16 @@ void Module::addStart(const Name& s) {
   start = s;
 }
 
+void Module::removeFunctionType(Name name) {
+  for (size_t i = 0; i < functionTypes.size(); i++) {
+    if (functionTypes[i]->name == name) {
+      functionTypes.erase(functionTypes.begin() + i);
+      break;
+    }
+  }
+  functionTypesMap.erase(name);
+}
+
 void Module::removeImport(Name name) {
   for (size_t i = 0; i < imports.size(); i++) {
     if (imports[i]->name == name) {
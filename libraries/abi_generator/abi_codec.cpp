@@ -0,0 +1,529 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <contento/abi_generator/abi_codec.hpp>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace contento { namespace chain {
+
+   // Integers go to and from the wire with memcpy, which matches the little
+   // endian layout written by cosiolib on every host we build indexers for.
+
+   namespace {
+
+      const char hexmap[] = "0123456789abcdef";
+
+      void write_varint( vector<char>& out, uint64_t val ) {
+         do {
+            uint8_t b = uint8_t(val) & 0x7f;
+            val >>= 7;
+            b |= ((val > 0) << 7);
+            out.push_back(char(b));
+         } while( val );
+      }
+
+      template<typename T>
+      void write_raw( vector<char>& out, T v ) {
+         char buf[sizeof(T)];
+         memcpy(buf, &v, sizeof(T));
+         out.insert(out.end(), buf, buf + sizeof(T));
+      }
+
+      string to_hex( const char* data, size_t size ) {
+         string s(size * 2, ' ');
+         for( size_t i = 0; i < size; ++i ) {
+            s[2 * i]     = hexmap[(uint8_t(data[i]) & 0xF0) >> 4];
+            s[2 * i + 1] = hexmap[uint8_t(data[i]) & 0x0F];
+         }
+         return s;
+      }
+
+      int from_hex_digit( char c ) {
+         if( c >= '0' && c <= '9' ) return c - '0';
+         if( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+         if( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+         throw abi_codec_exception(string("invalid hex digit '") + c + "'");
+      }
+
+      void write_hex( vector<char>& out, const string& hex ) {
+         if( hex.size() % 2 )
+            throw abi_codec_exception("hex string has an odd number of digits");
+         for( size_t i = 0; i < hex.size(); i += 2 )
+            out.push_back(char((from_hex_digit(hex[i]) << 4) | from_hex_digit(hex[i + 1])));
+      }
+
+      const string& get_string( const json& value, const char* what ) {
+         if( !value.is_string() )
+            throw abi_codec_exception(string(what) + " expects a string, got " + value.dump());
+         return value.get_ref<const string&>();
+      }
+
+      template<typename T>
+      T get_integer( const json& value ) {
+         if( value.is_number_unsigned() ) {
+            auto v = value.get<uint64_t>();
+            if( v <= uint64_t(std::numeric_limits<T>::max()) )
+               return T(v);
+         } else if( value.is_number_integer() ) {
+            auto v = value.get<int64_t>();
+            if( v >= int64_t(std::numeric_limits<T>::min()) && (v < 0 || uint64_t(v) <= uint64_t(std::numeric_limits<T>::max())) )
+               return T(v);
+         } else {
+            throw abi_codec_exception("expected an integer, got " + value.dump());
+         }
+         throw abi_codec_exception("integer out of range: " + value.dump());
+      }
+
+      abi_codec::instruction builtin_instruction( const type_name& type ) {
+         typedef abi_codec::opcode op;
+         static const std::unordered_map<type_name, abi_codec::instruction> builtins = [] {
+            std::unordered_map<type_name, abi_codec::instruction> m;
+            auto add = [&m]( const char* n, op code, uint32_t arg ) {
+               abi_codec::instruction ins;
+               ins.op = code;
+               ins.arg = arg;
+               m.emplace(n, ins);
+            };
+            add("bool",               op::op_bool,     0);
+            add("int8",               op::op_int8,     0);
+            add("uint8",              op::op_uint8,    0);
+            add("int16",              op::op_int16,    0);
+            add("uint16",             op::op_uint16,   0);
+            add("int32",              op::op_int32,    0);
+            add("uint32",             op::op_uint32,   0);
+            add("int64",              op::op_int64,    0);
+            add("uint64",             op::op_uint64,   0);
+            add("cosio::name",        op::op_string,   0);
+            add("cosio::coin_amount", op::op_uint64,   0);
+            add("cosio::bytes",       op::op_bytes,    0);
+            add("cosio::checksum160", op::op_checksum, 20);
+            add("cosio::checksum256", op::op_checksum, 32);
+            add("cosio::checksum512", op::op_checksum, 64);
+            add("std::string",        op::op_string,   0);
+            return m;
+         }();
+         auto itr = builtins.find(type);
+         if( itr == builtins.end() )
+            throw abi_codec_exception("no wire format for built-in type " + type);
+         return itr->second;
+      }
+
+      void check_depth( size_t recursion_depth ) {
+         if( recursion_depth > abi_serializer::max_recursion_depth )
+            throw abi_codec_exception("value nesting too deep");
+      }
+
+   }
+
+   struct abi_codec::reader {
+      const char* pos;
+      const char* end;
+
+      void need( size_t n ) {
+         if( size_t(end - pos) < n )
+            throw abi_codec_exception("unexpected end of data");
+      }
+
+      template<typename T>
+      T read() {
+         need(sizeof(T));
+         T v;
+         memcpy(&v, pos, sizeof(T));
+         pos += sizeof(T);
+         return v;
+      }
+
+      uint32_t read_varint() {
+         uint64_t v = 0;
+         for( uint8_t by = 0; ; by += 7 ) {
+            if( by > 28 )
+               throw abi_codec_exception("unsigned_int is too long");
+            need(1);
+            uint8_t b = uint8_t(*pos++);
+            v |= uint64_t(b & 0x7f) << by;
+            if( !(b & 0x80) )
+               break;
+         }
+         if( v > std::numeric_limits<uint32_t>::max() )
+            throw abi_codec_exception("unsigned_int is out of range");
+         return uint32_t(v);
+      }
+
+      const char* read_block( size_t n ) {
+         need(n);
+         auto p = pos;
+         pos += n;
+         return p;
+      }
+   };
+
+   abi_codec::abi_codec( const abi_def& abi )
+   :abis(abi)
+   {
+      for( const auto& t : abi.types )
+         compile_type(t.new_type_name, 0);
+      for( const auto& s : abi.structs )
+         compile_type(s.name, 0);
+      for( const auto& a : abi.actions )
+         compile_type(a.type, 0);
+      for( const auto& t : abi.tables )
+         compile_type(t.type, 0);
+   }
+
+   const struct_def* abi_codec::find_struct( const type_name& type )const {
+      auto itr = abis.structs.find(type);
+      if( itr == abis.structs.end() && type.find('<') == string::npos ) {
+         auto pos = type.rfind("::");
+         if( pos != string::npos )
+            itr = abis.structs.find(type.substr(pos + 2));
+      }
+      return itr != abis.structs.end() ? &itr->second : nullptr;
+   }
+
+   abi_codec::type_id abi_codec::compile_type( const type_name& type, size_t recursion_depth ) {
+      if( ++recursion_depth > abi_serializer::max_recursion_depth )
+         throw abi_codec_exception("type nesting too deep at " + type);
+
+      auto itr = types.find(type);
+      if( itr != types.end() )
+         return itr->second;
+
+      type_id id;
+      if( abis.is_builtin_type(type) ) {
+         id = entries.size();
+         entries.push_back(builtin_instruction(type));
+      } else if( abis.is_array(type) ) {
+         instruction ins;
+         ins.op = opcode::op_array;
+         ins.arg = compile_type(abis.fundamental_type(type), recursion_depth);
+         id = entries.size();
+         entries.push_back(ins);
+      } else if( abis.is_optional(type) ) {
+         throw abi_codec_exception("optional types have no cosiolib wire format: " + type);
+      } else {
+         auto resolved = abis.resolve_type(type);
+         if( resolved != type ) {
+            id = compile_type(resolved, recursion_depth);
+         } else {
+            auto s = find_struct(type);
+            if( !s )
+               throw abi_codec_exception("unknown type " + type);
+            id = compile_struct(type, *s, recursion_depth);
+         }
+      }
+      types.emplace(type, id);
+      return id;
+   }
+
+   abi_codec::type_id abi_codec::compile_struct( const type_name& type, const struct_def& s, size_t recursion_depth ) {
+      // Register the entry before compiling the fields so that arrays of this
+      // struct can refer to it. Until the body is emitted the entry stays
+      // op_end, which is how a struct that directly contains itself is caught.
+      type_id id = entries.size();
+      entries.emplace_back();
+      types.emplace(type, id);
+      types.emplace(s.name, id);
+
+      vector<instruction> body;
+      if( !s.base.empty() ) {
+         instruction base = entries[compile_type(s.base, recursion_depth)];
+         if( base.op != opcode::op_struct )
+            throw abi_codec_exception("base of " + s.name + " is not a struct: " + s.base);
+         base.op = opcode::op_base;
+         body.push_back(base);
+      }
+      for( const auto& field : s.fields ) {
+         instruction ins = entries[compile_type(field.type, recursion_depth)];
+         if( ins.op == opcode::op_end )
+            throw abi_codec_exception("struct " + s.name + " contains itself through field " + field.name);
+         ins.key = keys.size();
+         keys.push_back(field.name);
+         body.push_back(ins);
+      }
+      body.emplace_back();
+
+      instruction& entry = entries[id];
+      entry.op = opcode::op_struct;
+      entry.arg = code.size();
+      entry.count = s.fields.size() + (s.base.empty() ? 0 : 1);
+      code.insert(code.end(), body.begin(), body.end());
+      return id;
+   }
+
+   bool abi_codec::find_type( const type_name& type, type_id& id )const {
+      auto itr = types.find(type);
+      if( itr == types.end() )
+         return false;
+      id = itr->second;
+      return true;
+   }
+
+   abi_codec::type_id abi_codec::get_type( const type_name& type )const {
+      type_id id;
+      if( !find_type(type, id) )
+         throw abi_codec_exception("type is not part of the ABI: " + type);
+      return id;
+   }
+
+   abi_codec::type_id abi_codec::get_action_type( const name& action )const {
+      auto type = abis.get_action_type(action);
+      if( type.empty() )
+         throw abi_codec_exception("unknown action " + action);
+      return get_type(type);
+   }
+
+   abi_codec::type_id abi_codec::get_table_type( const name& table )const {
+      auto type = abis.get_table_type(table);
+      if( type.empty() )
+         throw abi_codec_exception("unknown table " + table);
+      return get_type(type);
+   }
+
+   void abi_codec::pack_value( const instruction& ins, const json& value, vector<char>& out, size_t recursion_depth )const {
+      switch( ins.op ) {
+         case opcode::op_bool:
+            if( !value.is_boolean() )
+               throw abi_codec_exception("expected a bool, got " + value.dump());
+            out.push_back(char(value.get<bool>() ? 1 : 0));
+            break;
+         case opcode::op_int8:   write_raw(out, get_integer<int8_t>(value));   break;
+         case opcode::op_uint8:  write_raw(out, get_integer<uint8_t>(value));  break;
+         case opcode::op_int16:  write_raw(out, get_integer<int16_t>(value));  break;
+         case opcode::op_uint16: write_raw(out, get_integer<uint16_t>(value)); break;
+         case opcode::op_int32:  write_raw(out, get_integer<int32_t>(value));  break;
+         case opcode::op_uint32: write_raw(out, get_integer<uint32_t>(value)); break;
+         case opcode::op_int64:  write_raw(out, get_integer<int64_t>(value));  break;
+         case opcode::op_uint64: write_raw(out, get_integer<uint64_t>(value)); break;
+         case opcode::op_string: {
+            const auto& s = get_string(value, "string");
+            write_varint(out, s.size());
+            out.insert(out.end(), s.begin(), s.end());
+            break;
+         }
+         case opcode::op_bytes: {
+            const auto& s = get_string(value, "cosio::bytes");
+            write_varint(out, s.size() / 2);
+            write_hex(out, s);
+            break;
+         }
+         case opcode::op_checksum: {
+            const auto& s = get_string(value, "checksum");
+            if( s.size() != ins.arg * 2 )
+               throw abi_codec_exception("checksum expects " + std::to_string(ins.arg * 2) + " hex digits, got " + value.dump());
+            write_varint(out, ins.arg);
+            write_hex(out, s);
+            break;
+         }
+         case opcode::op_array: {
+            if( !value.is_array() )
+               throw abi_codec_exception("expected an array, got " + value.dump());
+            check_depth(++recursion_depth);
+            const auto& element = entries[ins.arg];
+            write_varint(out, value.size());
+            for( const auto& v : value )
+               pack_value(element, v, out, recursion_depth);
+            break;
+         }
+         case opcode::op_struct:
+            if( !value.is_object() )
+               throw abi_codec_exception("expected an object, got " + value.dump());
+            write_varint(out, ins.count);
+            pack_body(ins.arg, value, out, recursion_depth);
+            break;
+         default:
+            throw abi_codec_exception("malformed codec program");
+      }
+   }
+
+   void abi_codec::pack_body( uint32_t pc, const json& value, vector<char>& out, size_t recursion_depth )const {
+      check_depth(++recursion_depth);
+      for( ; code[pc].op != opcode::op_end; ++pc ) {
+         const auto& ins = code[pc];
+         if( ins.op == opcode::op_base ) {
+            write_varint(out, ins.count);
+            pack_body(ins.arg, value, out, recursion_depth);
+            continue;
+         }
+         auto itr = value.find(keys[ins.key]);
+         if( itr == value.end() )
+            throw abi_codec_exception("missing field " + keys[ins.key]);
+         pack_value(ins, *itr, out, recursion_depth);
+      }
+   }
+
+   void abi_codec::pack( type_id type, const json& value, vector<char>& out )const {
+      pack_value(entries.at(type), value, out, 0);
+   }
+
+   vector<char> abi_codec::pack( const type_name& type, const json& value )const {
+      vector<char> out;
+      pack(get_type(type), value, out);
+      return out;
+   }
+
+   void abi_codec::unpack_value( const instruction& ins, reader& r, json& out, size_t recursion_depth )const {
+      switch( ins.op ) {
+         case opcode::op_bool:   out = r.read<uint8_t>() != 0; break;
+         case opcode::op_int8:   out = int64_t(r.read<int8_t>());    break;
+         case opcode::op_uint8:  out = uint64_t(r.read<uint8_t>());  break;
+         case opcode::op_int16:  out = int64_t(r.read<int16_t>());   break;
+         case opcode::op_uint16: out = uint64_t(r.read<uint16_t>()); break;
+         case opcode::op_int32:  out = int64_t(r.read<int32_t>());   break;
+         case opcode::op_uint32: out = uint64_t(r.read<uint32_t>()); break;
+         case opcode::op_int64:  out = r.read<int64_t>();            break;
+         case opcode::op_uint64: out = r.read<uint64_t>();           break;
+         case opcode::op_string: {
+            auto size = r.read_varint();
+            auto data = r.read_block(size);
+            out = string(data, size);
+            break;
+         }
+         case opcode::op_bytes: {
+            auto size = r.read_varint();
+            auto data = r.read_block(size);
+            out = to_hex(data, size);
+            break;
+         }
+         case opcode::op_checksum: {
+            auto size = r.read_varint();
+            if( size != ins.arg )
+               throw abi_codec_exception("checksum size and unpacked size don't match");
+            out = to_hex(r.read_block(size), size);
+            break;
+         }
+         case opcode::op_array: {
+            check_depth(++recursion_depth);
+            auto size = r.read_varint();
+            const auto& element = entries[ins.arg];
+            out = json::array();
+            // every element takes at least one byte, so this bounds the reservation
+            out.get_ref<json::array_t&>().reserve(std::min<size_t>(size, r.end - r.pos));
+            for( uint32_t i = 0; i < size; ++i ) {
+               out.push_back(json());
+               unpack_value(element, r, out.back(), recursion_depth);
+            }
+            break;
+         }
+         case opcode::op_struct: {
+            if( r.read_varint() != ins.count )
+               throw abi_codec_exception("struct field count mismatched");
+            out = json::object();
+            unpack_body(ins.arg, r, out, recursion_depth);
+            break;
+         }
+         default:
+            throw abi_codec_exception("malformed codec program");
+      }
+   }
+
+   void abi_codec::unpack_body( uint32_t pc, reader& r, json& out, size_t recursion_depth )const {
+      check_depth(++recursion_depth);
+      auto& object = out.get_ref<json::object_t&>();
+      for( ; code[pc].op != opcode::op_end; ++pc ) {
+         const auto& ins = code[pc];
+         if( ins.op == opcode::op_base ) {
+            if( r.read_varint() != ins.count )
+               throw abi_codec_exception("base struct field count mismatched");
+            unpack_body(ins.arg, r, out, recursion_depth);
+            continue;
+         }
+         unpack_value(ins, r, object[keys[ins.key]], recursion_depth);
+      }
+   }
+
+   json abi_codec::unpack( type_id type, const char* data, size_t size )const {
+      reader r{data, data + size};
+      json out;
+      unpack_value(entries.at(type), r, out, 0);
+      if( r.pos != r.end )
+         throw abi_codec_exception("unpacked value does not consume all of its data");
+      return out;
+   }
+
+   json abi_codec::unpack( const type_name& type, const vector<char>& data )const {
+      return unpack(get_type(type), data.data(), data.size());
+   }
+
+   void abi_codec::unpack_batch( type_id type, const vector<row>& rows, vector<json>& out )const {
+      const auto& ins = entries.at(type);
+      out.reserve(out.size() + rows.size());
+      for( const auto& row : rows ) {
+         reader r{row.data, row.data + row.size};
+         out.emplace_back();
+         unpack_value(ins, r, out.back(), 0);
+         if( r.pos != r.end )
+            throw abi_codec_exception("unpacked row does not consume all of its data");
+      }
+   }
+
+   void abi_codec::skip_value( const instruction& ins, reader& r, size_t recursion_depth )const {
+      switch( ins.op ) {
+         case opcode::op_bool:
+         case opcode::op_int8:
+         case opcode::op_uint8:  r.read_block(1); break;
+         case opcode::op_int16:
+         case opcode::op_uint16: r.read_block(2); break;
+         case opcode::op_int32:
+         case opcode::op_uint32: r.read_block(4); break;
+         case opcode::op_int64:
+         case opcode::op_uint64: r.read_block(8); break;
+         case opcode::op_string:
+         case opcode::op_bytes:
+         case opcode::op_checksum: r.read_block(r.read_varint()); break;
+         case opcode::op_array: {
+            check_depth(++recursion_depth);
+            auto size = r.read_varint();
+            const auto& element = entries[ins.arg];
+            for( uint32_t i = 0; i < size; ++i )
+               skip_value(element, r, recursion_depth);
+            break;
+         }
+         case opcode::op_struct:
+         case opcode::op_base: {
+            check_depth(++recursion_depth);
+            if( r.read_varint() != ins.count )
+               throw abi_codec_exception("struct field count mismatched");
+            for( uint32_t pc = ins.arg; code[pc].op != opcode::op_end; ++pc )
+               skip_value(code[pc], r, recursion_depth);
+            break;
+         }
+         default:
+            throw abi_codec_exception("malformed codec program");
+      }
+   }
+
+   bool abi_codec::find_in_body( uint32_t pc, const string& field, reader& r, row& value, size_t recursion_depth )const {
+      check_depth(++recursion_depth);
+      for( ; code[pc].op != opcode::op_end; ++pc ) {
+         const auto& ins = code[pc];
+         if( ins.op == opcode::op_base ) {
+            if( r.read_varint() != ins.count )
+               throw abi_codec_exception("base struct field count mismatched");
+            if( find_in_body(ins.arg, field, r, value, recursion_depth) )
+               return true;
+            continue;
+         }
+         auto begin = r.pos;
+         skip_value(ins, r, recursion_depth);
+         if( keys[ins.key] == field ) {
+            value = row{begin, size_t(r.pos - begin)};
+            return true;
+         }
+      }
+      return false;
+   }
+
+   bool abi_codec::find_field( type_id type, const string& field, const char* data, size_t size, row& value )const {
+      const auto& ins = entries.at(type);
+      if( ins.op != opcode::op_struct )
+         throw abi_codec_exception("fields can only be found in structs");
+      reader r{data, data + size};
+      if( r.read_varint() != ins.count )
+         throw abi_codec_exception("struct field count mismatched");
+      return find_in_body(ins.arg, field, r, value, 0);
+   }
+
+} }
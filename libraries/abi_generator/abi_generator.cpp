@@ -20,6 +20,11 @@ bool abi_generator::is_opt_enabled(abi_generator::optimization o) {
 
 void abi_generator::set_output(abi_def& output) {
   this->output = &output;
+  struct_index = name_index();
+  type_index = name_index();
+  action_index = name_index();
+  table_index = name_index();
+  resolved_types.clear();
 }
 
 void abi_generator::set_verbose(bool verbose) {
@@ -61,7 +66,7 @@ string abi_generator::remove_namespace(const string& full_name) {
 }
 
 bool abi_generator::is_builtin_type(const string& type_name) {
-  abi_serializer serializer;
+  static const abi_serializer serializer;
   auto rtype = resolve_type(type_name);
   return serializer.is_builtin_type(translate_type(rtype));
 }
@@ -97,12 +102,9 @@ string abi_generator::translate_type(const string& type_name) {
         const auto* type = rec_decl->getTypeForDecl();
         ABI_ASSERT(type != nullptr);
         
-        vector<string> all_types;
-        for(auto t : output->tables) {
-            all_types.push_back(t.type);
-        }
          auto rec_name = rec_decl->getNameAsString();
-         bool is_action_from_macro = std::find(all_types.begin(), all_types.end(), rec_name) != all_types.end();
+         bool is_action_from_macro = std::find_if(output->tables.begin(), output->tables.end(),
+                                                  [&rec_name](const table_def& t) { return t.type == rec_name; }) != output->tables.end();
         if(!is_action_from_macro) {
             return;
         }
@@ -345,8 +347,6 @@ bool abi_generator::is_string(const string& type) {
 }
 
 void abi_generator::get_all_fields(const struct_def& s, vector<field_def>& fields) {
-  abi_serializer abis(*output);
-
   for(const auto& field : s.fields) {
     fields.push_back(field);
   }
@@ -362,53 +362,55 @@ bool abi_generator::is_i64_index(const vector<field_def>& fields) {
   return fields.size() >= 1 && is_64bit(fields[0].type);
 }
 
-const table_def* abi_generator::find_table(const table_name& name) {
-  for( const auto& ta : output->tables ) {
-    if(ta.name == name) {
-      return &ta;
-    }
+template<typename T, typename KeyOf>
+const T* abi_generator::find_indexed(const vector<T>& items, name_index& index, const string& name, KeyOf key_of) {
+  for( ; index.indexed < items.size(); ++index.indexed ) {
+    // emplace keeps the first entry of a name, as the linear scans did
+    index.positions.emplace(key_of(items[index.indexed]), index.indexed);
+  }
+  auto itr = index.positions.find(name);
+  if( itr == index.positions.end() ) {
+    return nullptr;
   }
-  return nullptr;
+  return &items[itr->second];
+}
+
+const table_def* abi_generator::find_table(const table_name& name) {
+  return find_indexed(output->tables, table_index, name, [](const table_def& ta) { return ta.name; });
 }
 
 const type_def* abi_generator::find_type(const type_name& new_type_name) {
-  for( const auto& td : output->types ) {
-    if(td.new_type_name == new_type_name) {
-      return &td;
-    }
-  }
-  return nullptr;
+  return find_indexed(output->types, type_index, new_type_name, [](const type_def& td) { return td.new_type_name; });
 }
 
 const action_def* abi_generator::find_action(const action_name& name) {
-  for( const auto& ac : output->actions ) {
-    if(ac.name == name) {
-      return &ac;
-    }
-  }
-  return nullptr;
+  return find_indexed(output->actions, action_index, name, [](const action_def& ac) { return ac.name; });
 }
 
 const struct_def* abi_generator::find_struct(const type_name& name) {
-  auto rname = resolve_type(name);
-  for( const auto& st : output->structs ) {
-    if(st.name == rname) {
-      return &st;
-    }
-  }
-  return nullptr;
+  return find_indexed(output->structs, struct_index, resolve_type(name), [](const struct_def& st) { return st.name; });
 }
 
 type_name abi_generator::resolve_type(const type_name& type){
+  auto itr = resolved_types.find(type);
+  if( itr != resolved_types.end() ) {
+    return itr->second;
+  }
+
+  type_name resolved = type;
   const auto* td = find_type(type);
   if( td ) {
     for( auto i = output->types.size(); i > 0; --i ) { // avoid infinite recursion
       const type_name& t = td->type;
       td = find_type(t);
-      if( td == nullptr ) return t;
+      if( td == nullptr ) {
+        resolved = t;
+        break;
+      }
     }
   }
-  return type;
+  resolved_types.emplace(type, resolved);
+  return resolved;
 }
 
 bool abi_generator::is_one_filed_no_base(const string& type_name) {
@@ -503,6 +505,7 @@ clang::QualType abi_generator::add_typedef(const clang::QualType& tqt, size_t re
 
   if(!td && !is_struct_specialization(underlying_type) ) {
     output->types.push_back(abi_typedef);
+    resolved_types.clear();
   } else {
     if(td) ABI_ASSERT(abi_typedef.type == td->type);
   }
@@ -692,6 +695,8 @@ namespace contento { namespace chain {
        types.push_back( type_def{"coin_amount", "cosio::coin_amount"} );
        types.push_back( type_def{"bytes", "cosio::bytes"} );
        types.push_back( type_def{"string", "std::string"} );
+       types.push_back( type_def{"string_view", "std::string"} );
+       types.push_back( type_def{"bytes_view", "cosio::bytes"} );
        types.push_back( type_def{"checksum160", "cosio::checksum160"} );
        types.push_back( type_def{"checksum256", "cosio::checksum256"} );
        types.push_back( type_def{"checksum512", "cosio::checksum512"} );
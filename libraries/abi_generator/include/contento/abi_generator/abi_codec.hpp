@@ -0,0 +1,130 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+#include <contento/abi_generator/abi_serializer.hpp>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace contento { namespace chain {
+
+/**
+ *  Thrown when an ABI cannot be compiled, or when a value does not match the
+ *  type it is being packed as / unpacked from.
+ */
+struct abi_codec_exception : public std::runtime_error {
+   explicit abi_codec_exception( const string& what ) : std::runtime_error(what) {}
+};
+
+/**
+ *  Converts action parameters and table records between JSON and the binary
+ *  format written by COSIO_SERIALIZE / cosio::datastream.
+ *
+ *  The ABI is compiled once, in the constructor, into a flat program: every
+ *  type gets a single entry instruction, and every struct a contiguous body of
+ *  field instructions with the JSON keys already resolved. Packing and
+ *  unpacking only walk that program, so there are no ABI map lookups on the
+ *  per-field path. A compiled codec is immutable and may be shared between
+ *  threads; batch callers wanting more throughput can split rows across them.
+ *
+ *  Wire format, as produced by cosiolib:
+ *   - integers and cosio::coin_amount: little endian, bool as one byte
+ *   - std::string, cosio::name, cosio::bytes, T[]: unsigned_int length + data
+ *   - cosio::checksum160/256/512: unsigned_int size + raw hash bytes
+ *   - structs: unsigned_int field count, then the fields; a derived struct
+ *     counts its base as one extra field, serialized first as a nested struct
+ *
+ *  In JSON, base struct fields are flattened into the derived object, and
+ *  checksums and cosio::bytes are hex strings.
+ */
+class abi_codec {
+   public:
+      typedef uint32_t type_id;
+
+      struct row {
+         const char* data;
+         size_t      size;
+      };
+
+      explicit abi_codec( const abi_def& abi );
+
+      /**
+       * @brief Look up the compiled program of a type (struct, typedef, built-in, or array of one)
+       * @return false if the type was not part of the compiled ABI
+       */
+      bool      find_type( const type_name& type, type_id& id )const;
+      type_id   get_type( const type_name& type )const;
+      type_id   get_action_type( const name& action )const;
+      type_id   get_table_type( const name& table )const;
+
+      void         pack( type_id type, const json& value, vector<char>& out )const;
+      vector<char> pack( const type_name& type, const json& value )const;
+
+      /**
+       * @brief Decode one value; the whole buffer must be consumed
+       */
+      json unpack( type_id type, const char* data, size_t size )const;
+      json unpack( const type_name& type, const vector<char>& data )const;
+
+      /**
+       * @brief Decode many values of the same type, e.g. the rows of a table
+       *
+       * Results are appended to @p out.
+       */
+      void unpack_batch( type_id type, const vector<row>& rows, vector<json>& out )const;
+
+      /**
+       * @brief Locate a field of a packed struct without decoding the others, e.g. the primary key of a table record
+       *
+       * Fields of base structs are found too. On success, @p value points into @p data at the packed field.
+       * @return false if the struct has no field of that name
+       */
+      bool find_field( type_id type, const string& field, const char* data, size_t size, row& value )const;
+
+      enum class opcode : uint8_t {
+         op_end,
+         op_bool,
+         op_int8, op_uint8, op_int16, op_uint16, op_int32, op_uint32, op_int64, op_uint64,
+         op_string,
+         op_bytes,
+         op_checksum,   ///< arg: hash size
+         op_array,      ///< arg: entry of the element type
+         op_struct,     ///< arg: first instruction of the body, count: field count on the wire
+         op_base        ///< same as op_struct, but decoded into the enclosing object
+      };
+
+      struct instruction {
+         opcode   op    = opcode::op_end;
+         uint32_t arg   = 0;
+         uint32_t count = 0;
+         uint32_t key   = no_key;   ///< index into keys for struct fields
+      };
+
+      static constexpr uint32_t no_key = uint32_t(-1);
+
+   private:
+      struct reader;
+
+      type_id compile_type( const type_name& type, size_t recursion_depth );
+      type_id compile_struct( const type_name& type, const struct_def& s, size_t recursion_depth );
+      const struct_def* find_struct( const type_name& type )const;
+
+      // A struct may hold an array of itself, so the nesting of a value is
+      // bounded by its data rather than by the ABI; recursion_depth counts
+      // structs, bases and arrays entered, up to max_recursion_depth.
+      void pack_value( const instruction& ins, const json& value, vector<char>& out, size_t recursion_depth )const;
+      void pack_body( uint32_t pc, const json& value, vector<char>& out, size_t recursion_depth )const;
+      void unpack_value( const instruction& ins, reader& r, json& out, size_t recursion_depth )const;
+      void unpack_body( uint32_t pc, reader& r, json& out, size_t recursion_depth )const;
+      void skip_value( const instruction& ins, reader& r, size_t recursion_depth )const;
+      bool find_in_body( uint32_t pc, const string& field, reader& r, row& value, size_t recursion_depth )const;
+
+      abi_serializer                         abis;
+      vector<instruction>                    entries;   ///< one per compiled type, indexed by type_id
+      vector<instruction>                    code;      ///< struct bodies, each terminated by op_end
+      vector<string>                         keys;
+      std::unordered_map<type_name, type_id> types;
+};
+
+} } // contento::chain
@@ -56,6 +56,11 @@ struct type_def {
         out["new_type_name"] = new_type_name.c_str();
         out["type"] = type;
     }
+
+    void from_json2(const json& in) {
+        new_type_name = in.at("new_type_name").get<string>();
+        type = in.at("type").get<string>();
+    }
 };
 
 struct field_def {
@@ -75,6 +80,11 @@ struct field_def {
         out["name"] = name;
         out["type"] = type;
     }
+
+    void from_json2(const json& in){
+        name = in.at("name").get<string>();
+        type = in.at("type").get<string>();
+    }
 };
 
 struct struct_def {
@@ -103,6 +113,16 @@ struct struct_def {
         }
         out["fields"] = ofields;
     }
+
+    void from_json2(const json& in){
+        name = in.at("name").get<string>();
+        base = in.value("base", string());
+        fields.clear();
+        for(const auto& i : in.at("fields")){
+            fields.emplace_back();
+            fields.back().from_json2(i);
+        }
+    }
 };
 
 struct action_def {
@@ -118,6 +138,11 @@ struct action_def {
         out["name"] = name;
         out["type"] = type;
     }
+
+    void from_json2(const json& in){
+        name = in.at("name").get<string>();
+        type = in.at("type").get<string>();
+    }
 };
     
     struct table_def {
@@ -149,6 +174,18 @@ struct action_def {
             }
         }
         
+        void from_json2(const json& in){
+            name = in.at("name").get<string>();
+            type = in.at("type").get<string>();
+            keys.clear();
+            keys.push_back(in.at("primary").get<string>());
+            if (in.count("secondary")) {
+                for(const auto& i : in.at("secondary")){
+                    keys.push_back(i.get<string>());
+                }
+            }
+        }
+        
     };
 
 struct error_message {
@@ -220,6 +257,38 @@ struct abi_def {
             out["tables"] = obtrees;
         }
     }
+    
+    void from_json2(const json& in){
+        version = in.value("version", version);
+        types.clear();
+        structs.clear();
+        actions.clear();
+        tables.clear();
+        if (in.count("types")) {
+            for(const auto& i : in.at("types")){
+                types.emplace_back();
+                types.back().from_json2(i);
+            }
+        }
+        if (in.count("structs")) {
+            for(const auto& i : in.at("structs")){
+                structs.emplace_back();
+                structs.back().from_json2(i);
+            }
+        }
+        if (in.count("actions")) {
+            for(const auto& i : in.at("actions")){
+                actions.emplace_back();
+                actions.back().from_json2(i);
+            }
+        }
+        if (in.count("tables")) {
+            for(const auto& i : in.at("tables")){
+                tables.emplace_back();
+                tables.back().from_json2(i);
+            }
+        }
+    }
 };
 
 abi_def contento_contract_abi(const abi_def& contento_system_abi);
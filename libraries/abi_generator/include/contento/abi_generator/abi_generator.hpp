@@ -1,6 +1,7 @@
 #pragma once
 
 #include <set>
+#include <unordered_map>
 #include <regex>
 #include <algorithm>
 #include <memory>
@@ -75,6 +76,24 @@ namespace contento {
          string                 target_contract;
          vector<string>         target_actions;
 
+         /**
+           * @brief Name index over one of the output vectors. The vectors are only ever appended to
+           * (abi_macro_handler adds tables directly), so an index catches up with new entries lazily.
+           */
+         struct name_index {
+            size_t                          indexed = 0;
+            unordered_map<string, size_t>   positions;
+         };
+         name_index                         struct_index;
+         name_index                         type_index;
+         name_index                         action_index;
+         name_index                         table_index;
+         /**
+           * @brief resolve_type results. Types are added while the AST is still being walked, and a
+           * new typedef can change any earlier resolution, so add_typedef clears this when it adds one.
+           */
+         unordered_map<type_name, type_name> resolved_types;
+
       public:
 
          enum optimization {
@@ -173,6 +192,9 @@ namespace contento {
 
          const struct_def* find_struct(const type_name& name);
 
+         template<typename T, typename KeyOf>
+         const T* find_indexed(const vector<T>& items, name_index& index, const string& name, KeyOf key_of);
+
          type_name resolve_type(const type_name& type);
 
          bool is_one_filed_no_base(const string& type_name);
@@ -204,231 +226,241 @@ namespace contento {
          clang::CXXRecordDecl::base_class_range get_struct_bases(const clang::QualType& qt);
    };
 
+   /**
+     * @brief Collects the struct/union/enum definitions of a translation unit and hands them to the
+     * abi_generator once the whole unit is parsed, when the COSIO_ABI and table macros seen by
+     * abi_macro_handler are known.
+     */
    struct abi_generator_astconsumer : public ASTConsumer {
       abi_generator& abi_gen;
+      const string& contract;
+      const vector<string>& actions;
+      vector<TagDecl*> tag_decls;
 
-      abi_generator_astconsumer(CompilerInstance& compiler_instance, abi_generator& abi_gen)
-      :abi_gen(abi_gen)
+      abi_generator_astconsumer(CompilerInstance& compiler_instance, abi_generator& abi_gen,
+                                const string& contract, const vector<string>& actions)
+      :abi_gen(abi_gen), contract(contract), actions(actions)
       {
          abi_gen.set_compiler_instance(compiler_instance);
       }
 
       void HandleTagDeclDefinition(TagDecl* tag_decl) override {
-         abi_gen.handle_tagdecl_definition(tag_decl);
+         tag_decls.push_back(tag_decl);
       }
-   };
-
-   struct find_contento_abi_macro_action : public PreprocessOnlyAction {
 
-         string& contract;
-         vector<string>& actions;
-         const string& abi_context;
-       abi_def& output;
-       
-
-         find_contento_abi_macro_action(string& contract, vector<string>& actions, const string& abi_context,abi_def& output
-            ): contract(contract),
-            actions(actions), abi_context(abi_context),output(output) {
+      void HandleTranslationUnit(ASTContext& ast_context) override {
+         abi_gen.set_target_contract(contract, actions);
+         for( auto* tag_decl : tag_decls ) {
+            abi_gen.handle_tagdecl_definition(tag_decl);
          }
+      }
+   };
 
-         struct callback_handler : public PPCallbacks {
-
-            CompilerInstance& compiler_instance;
-            find_contento_abi_macro_action& act;
-
-            callback_handler(CompilerInstance& compiler_instance, find_contento_abi_macro_action& act)
-            : compiler_instance(compiler_instance), act(act) {}
-
-            string remove_namespace(const string& full_name) {
-               int i = full_name.size();
-               int on_spec = 0;
-               int colons = 0;
-               while( --i >= 0 ) {
-                  if( full_name[i] == '>' ) {
-                     ++on_spec; colons=0;
-                  } else if( full_name[i] == '<' ) {
-                     --on_spec; colons=0;
-                  } else if( full_name[i] == ':' && !on_spec) {
-                     if (++colons == 2)
-                        return full_name.substr(i+2);
-                  } else {
-                     colons = 0;
-                  }
-               }
-               return full_name;
-            }
-
-            void MacroExpands (const Token &token, const MacroDefinition &md, SourceRange range, const MacroArgs *args) override {
-
-               auto* id = token.getIdentifierInfo();
-               if( id == nullptr ) return;
-                auto name = id->getName();
-                if( name == "COSIO_ABI" ) {
-                    return handle_cosio_abi(md,range,args);
-                } else if ( name == "COSIO_DEFINE_TABLE" ) {
-                    return handle_cosio_define_table(md,range,args);
-                } else if ( name == "COSIO_DEFINE_NAMED_TABLE" ) {
-                    return handle_cosio_define_named_table(md,range,args);
-                } else if ( name == "COSIO_DEFINE_NAMED_SINGLETON" ) {
-                    return handle_cosio_define_named_singleton(md,range,args);
-                } else {
-                    // todo
-                }
+   /**
+     * @brief Records the COSIO_ABI and table definition macros while the translation unit is preprocessed
+     */
+   struct abi_macro_handler : public PPCallbacks {
+
+      CompilerInstance& compiler_instance;
+      string& contract;
+      vector<string>& actions;
+      const string& abi_context;
+      abi_def& output;
+
+      abi_macro_handler(CompilerInstance& compiler_instance, string& contract, vector<string>& actions,
+                        const string& abi_context, abi_def& output)
+      : compiler_instance(compiler_instance), contract(contract), actions(actions),
+        abi_context(abi_context), output(output) {}
+
+      string remove_namespace(const string& full_name) {
+         int i = full_name.size();
+         int on_spec = 0;
+         int colons = 0;
+         while( --i >= 0 ) {
+            if( full_name[i] == '>' ) {
+               ++on_spec; colons=0;
+            } else if( full_name[i] == '<' ) {
+               --on_spec; colons=0;
+            } else if( full_name[i] == ':' && !on_spec) {
+               if (++colons == 2)
+                  return full_name.substr(i+2);
+            } else {
+               colons = 0;
             }
-             
-         private:
-             void handle_cosio_abi(const MacroDefinition &md, SourceRange range, const MacroArgs *args){
-                 const auto& sm = compiler_instance.getSourceManager();
-                 auto file_name = sm.getFilename(range.getBegin());
-                 if ( !act.abi_context.empty() && !file_name.startswith(act.abi_context) ) {
-                     return;
-                 }
-                 
-                 ABI_ASSERT( md.getMacroInfo()->getNumArgs() == 2 );
-                 
-                 clang::SourceLocation b(range.getBegin()), _e(range.getEnd());
-                 clang::SourceLocation e(clang::Lexer::getLocForEndOfToken(_e, 0, sm, compiler_instance.getLangOpts()));
-                 auto macrostr = string(sm.getCharacterData(b), sm.getCharacterData(e)-sm.getCharacterData(b));
-                 
-                 regex r(R"(COSIO_ABI\s*\(\s*(.+?)\s*,((?:.+?)*)\s*\))");
-                 smatch smatch;
-                 auto res = regex_search(macrostr, smatch, r);
-                 ABI_ASSERT( res );
-                 
-                 act.contract = remove_namespace(smatch[1].str());
-                 
-                 auto actions_str = smatch[2].str();
-                 boost::trim(actions_str);
-                 actions_str = actions_str.substr(1);
-                 actions_str.pop_back();
-                 boost::remove_erase_if(actions_str, boost::is_any_of(" ("));
-                 
-                 boost::split(act.actions, actions_str, boost::is_any_of(")"));
-             }
-             
-             void handle_cosio_define_table(const MacroDefinition &md, SourceRange range, const MacroArgs *args){
-                 const auto& sm = compiler_instance.getSourceManager();
-                 auto file_name = sm.getFilename(range.getBegin());
-                 if ( !act.abi_context.empty() && !file_name.startswith(act.abi_context) ) {
-                     return;
-                 }
-                 
-                 ABI_ASSERT( md.getMacroInfo()->getNumArgs() == 3 );
-                 
-                 clang::SourceLocation b(range.getBegin()), _e(range.getEnd());
-                 clang::SourceLocation e(clang::Lexer::getLocForEndOfToken(_e, 0, sm, compiler_instance.getLangOpts()));
-                 auto macrostr = string(sm.getCharacterData(b), sm.getCharacterData(e)-sm.getCharacterData(b));
-                 //COSIO_DEFINE_TABLE( table_greetings, greeting, (name)(count)(last_seen) );
-                 regex r(R"(COSIO_DEFINE_TABLE\s*\(\s*(.+?)\s*,\s*(.+?)\s*,((?:.+?)*)\s*\))");
-                 smatch smatch;
-                 auto res = regex_search(macrostr, smatch, r);
-                 ABI_ASSERT( res );
-                 
-                 table_def table;
-                 table.name = smatch[1];
-                 table.type = smatch[2];
-                 
-                 
-                 auto actions_str = smatch[3].str();
-                 boost::trim(actions_str);
-                 actions_str = actions_str.substr(1);
-                 actions_str.pop_back();
-                 boost::remove_erase_if(actions_str, boost::is_any_of(" ("));
-                 
-                 boost::split(table.keys, actions_str, boost::is_any_of(")"));
-                 act.output.tables.push_back(table);
-             }
-             
-             void handle_cosio_define_named_table(const MacroDefinition &md, SourceRange range, const MacroArgs *args){
-                 const auto& sm = compiler_instance.getSourceManager();
-                 auto file_name = sm.getFilename(range.getBegin());
-                 if ( !act.abi_context.empty() && !file_name.startswith(act.abi_context) ) {
-                     return;
-                 }
-                 
-                 ABI_ASSERT( md.getMacroInfo()->getNumArgs() == 4 );
-                 
-                 clang::SourceLocation b(range.getBegin()), _e(range.getEnd());
-                 clang::SourceLocation e(clang::Lexer::getLocForEndOfToken(_e, 0, sm, compiler_instance.getLangOpts()));
-                 auto macrostr = string(sm.getCharacterData(b), sm.getCharacterData(e)-sm.getCharacterData(b));
-                 //COSIO_DEFINE_TABLE( table_greetings, greeting, (name)(count)(last_seen) );
-                 regex r(R"(COSIO_DEFINE_NAMED_TABLE\s*\(\s*(.+?)\s*,\s*(.+?)\s*,\s*(.+?)\s*,((?:.+?)*)\s*\))");
-                 smatch smatch;
-                 auto res = regex_search(macrostr, smatch, r);
-                 ABI_ASSERT( res );
-                 
-                 table_def table;
-                 auto tmp_name = smatch[2].str();
-                 boost::remove_erase_if(tmp_name, boost::is_any_of("\""));
-                 table.name = tmp_name;
-                 table.type = smatch[3];
-                 
-                 
-                 auto actions_str = smatch[4].str();
-                 boost::trim(actions_str);
-                 actions_str = actions_str.substr(1);
-                 actions_str.pop_back();
-                 boost::remove_erase_if(actions_str, boost::is_any_of(" ("));
-                 
-                 boost::split(table.keys, actions_str, boost::is_any_of(")"));
-                 act.output.tables.push_back(table);
-             }
-             
-             void handle_cosio_define_named_singleton(const MacroDefinition &md, SourceRange range, const MacroArgs *args){
-                 const auto& sm = compiler_instance.getSourceManager();
-                 auto file_name = sm.getFilename(range.getBegin());
-                 if ( !act.abi_context.empty() && !file_name.startswith(act.abi_context) ) {
-                     return;
-                 }
-                 
-                 ABI_ASSERT( md.getMacroInfo()->getNumArgs() == 3 );
-                 
-                 clang::SourceLocation b(range.getBegin()), _e(range.getEnd());
-                 clang::SourceLocation e(clang::Lexer::getLocForEndOfToken(_e, 0, sm, compiler_instance.getLangOpts()));
-                 auto macrostr = string(sm.getCharacterData(b), sm.getCharacterData(e)-sm.getCharacterData(b));
-                 //COSIO_DEFINE_TABLE( table_greetings, greeting, (name)(count)(last_seen) );
-                 regex r(R"(COSIO_DEFINE_NAMED_SINGLETON\s*\(\s*(.+?)\s*,\s*(.+?)\s*,\s*(.+?)\s*\))");
-                 smatch smatch;
-                 auto res = regex_search(macrostr, smatch, r);
-                 ABI_ASSERT( res );
-                 
-                 table_def table;
-                 auto tmp_name = smatch[2].str();
-                 boost::remove_erase_if(tmp_name, boost::is_any_of("\""));
-                 table.name = tmp_name;
-                 table.type = smatch[3];
-                 
-                 table.keys.push_back("id");
-                 act.output.tables.push_back(table);
-             }
-         };
-
-         void ExecuteAction() override {
-            getCompilerInstance().getPreprocessor().addPPCallbacks(
-               llvm::make_unique<callback_handler>(getCompilerInstance(), *this)
-            );
-            PreprocessOnlyAction::ExecuteAction();
-         };
+         }
+         return full_name;
+      }
 
+      void MacroExpands (const Token &token, const MacroDefinition &md, SourceRange range, const MacroArgs *args) override {
+
+         auto* id = token.getIdentifierInfo();
+         if( id == nullptr ) return;
+          auto name = id->getName();
+          if( name == "COSIO_ABI" ) {
+              return handle_cosio_abi(md,range,args);
+          } else if ( name == "COSIO_DEFINE_TABLE" || name == "COSIO_DEFINE_CACHED_TABLE" ) {
+              return handle_cosio_define_table(md,range,args);
+          } else if ( name == "COSIO_DEFINE_NAMED_TABLE" || name == "COSIO_DEFINE_NAMED_CACHED_TABLE" ) {
+              return handle_cosio_define_named_table(md,range,args);
+          } else if ( name == "COSIO_DEFINE_NAMED_SINGLETON" ) {
+              return handle_cosio_define_named_singleton(md,range,args);
+          } else {
+              // todo
+          }
+      }
+       
+   private:
+       void handle_cosio_abi(const MacroDefinition &md, SourceRange range, const MacroArgs *args){
+           const auto& sm = compiler_instance.getSourceManager();
+           auto file_name = sm.getFilename(range.getBegin());
+           if ( !abi_context.empty() && !file_name.startswith(abi_context) ) {
+               return;
+           }
+           
+           ABI_ASSERT( md.getMacroInfo()->getNumArgs() == 2 );
+           
+           clang::SourceLocation b(range.getBegin()), _e(range.getEnd());
+           clang::SourceLocation e(clang::Lexer::getLocForEndOfToken(_e, 0, sm, compiler_instance.getLangOpts()));
+           auto macrostr = string(sm.getCharacterData(b), sm.getCharacterData(e)-sm.getCharacterData(b));
+           
+           regex r(R"(COSIO_ABI\s*\(\s*(.+?)\s*,((?:.+?)*)\s*\))");
+           smatch smatch;
+           auto res = regex_search(macrostr, smatch, r);
+           ABI_ASSERT( res );
+           
+           contract = remove_namespace(smatch[1].str());
+           
+           auto actions_str = smatch[2].str();
+           boost::trim(actions_str);
+           actions_str = actions_str.substr(1);
+           actions_str.pop_back();
+           boost::remove_erase_if(actions_str, boost::is_any_of(" ("));
+           
+           boost::split(actions, actions_str, boost::is_any_of(")"));
+       }
+       
+       void handle_cosio_define_table(const MacroDefinition &md, SourceRange range, const MacroArgs *args){
+           const auto& sm = compiler_instance.getSourceManager();
+           auto file_name = sm.getFilename(range.getBegin());
+           if ( !abi_context.empty() && !file_name.startswith(abi_context) ) {
+               return;
+           }
+           
+           ABI_ASSERT( md.getMacroInfo()->getNumArgs() == 3 );
+           
+           clang::SourceLocation b(range.getBegin()), _e(range.getEnd());
+           clang::SourceLocation e(clang::Lexer::getLocForEndOfToken(_e, 0, sm, compiler_instance.getLangOpts()));
+           auto macrostr = string(sm.getCharacterData(b), sm.getCharacterData(e)-sm.getCharacterData(b));
+           //COSIO_DEFINE_TABLE( table_greetings, greeting, (name)(count)(last_seen) );
+           regex r(R"(COSIO_DEFINE_(?:CACHED_)?TABLE\s*\(\s*(.+?)\s*,\s*(.+?)\s*,((?:.+?)*)\s*\))");
+           smatch smatch;
+           auto res = regex_search(macrostr, smatch, r);
+           ABI_ASSERT( res );
+           
+           table_def table;
+           table.name = smatch[1];
+           table.type = smatch[2];
+           
+           
+           auto actions_str = smatch[3].str();
+           boost::trim(actions_str);
+           actions_str = actions_str.substr(1);
+           actions_str.pop_back();
+           boost::remove_erase_if(actions_str, boost::is_any_of(" ("));
+           
+           boost::split(table.keys, actions_str, boost::is_any_of(")"));
+           output.tables.push_back(table);
+       }
+       
+       void handle_cosio_define_named_table(const MacroDefinition &md, SourceRange range, const MacroArgs *args){
+           const auto& sm = compiler_instance.getSourceManager();
+           auto file_name = sm.getFilename(range.getBegin());
+           if ( !abi_context.empty() && !file_name.startswith(abi_context) ) {
+               return;
+           }
+           
+           ABI_ASSERT( md.getMacroInfo()->getNumArgs() == 4 );
+           
+           clang::SourceLocation b(range.getBegin()), _e(range.getEnd());
+           clang::SourceLocation e(clang::Lexer::getLocForEndOfToken(_e, 0, sm, compiler_instance.getLangOpts()));
+           auto macrostr = string(sm.getCharacterData(b), sm.getCharacterData(e)-sm.getCharacterData(b));
+           //COSIO_DEFINE_TABLE( table_greetings, greeting, (name)(count)(last_seen) );
+           regex r(R"(COSIO_DEFINE_NAMED_(?:CACHED_)?TABLE\s*\(\s*(.+?)\s*,\s*(.+?)\s*,\s*(.+?)\s*,((?:.+?)*)\s*\))");
+           smatch smatch;
+           auto res = regex_search(macrostr, smatch, r);
+           ABI_ASSERT( res );
+           
+           table_def table;
+           auto tmp_name = smatch[2].str();
+           boost::remove_erase_if(tmp_name, boost::is_any_of("\""));
+           table.name = tmp_name;
+           table.type = smatch[3];
+           
+           
+           auto actions_str = smatch[4].str();
+           boost::trim(actions_str);
+           actions_str = actions_str.substr(1);
+           actions_str.pop_back();
+           boost::remove_erase_if(actions_str, boost::is_any_of(" ("));
+           
+           boost::split(table.keys, actions_str, boost::is_any_of(")"));
+           output.tables.push_back(table);
+       }
+       
+       void handle_cosio_define_named_singleton(const MacroDefinition &md, SourceRange range, const MacroArgs *args){
+           const auto& sm = compiler_instance.getSourceManager();
+           auto file_name = sm.getFilename(range.getBegin());
+           if ( !abi_context.empty() && !file_name.startswith(abi_context) ) {
+               return;
+           }
+           
+           ABI_ASSERT( md.getMacroInfo()->getNumArgs() == 3 );
+           
+           clang::SourceLocation b(range.getBegin()), _e(range.getEnd());
+           clang::SourceLocation e(clang::Lexer::getLocForEndOfToken(_e, 0, sm, compiler_instance.getLangOpts()));
+           auto macrostr = string(sm.getCharacterData(b), sm.getCharacterData(e)-sm.getCharacterData(b));
+           //COSIO_DEFINE_TABLE( table_greetings, greeting, (name)(count)(last_seen) );
+           regex r(R"(COSIO_DEFINE_NAMED_SINGLETON\s*\(\s*(.+?)\s*,\s*(.+?)\s*,\s*(.+?)\s*\))");
+           smatch smatch;
+           auto res = regex_search(macrostr, smatch, r);
+           ABI_ASSERT( res );
+           
+           table_def table;
+           auto tmp_name = smatch[2].str();
+           boost::remove_erase_if(tmp_name, boost::is_any_of("\""));
+           table.name = tmp_name;
+           table.type = smatch[3];
+           
+           table.keys.push_back("id");
+           output.tables.push_back(table);
+       }
    };
 
   
+   /**
+     * @brief Generates the ABI in a single compilation: the preprocessor callbacks record the
+     * COSIO_ABI and table macros while the AST consumer collects type definitions, and both are
+     * resolved together at the end of the translation unit.
+     */
    class generate_abi_action : public ASTFrontendAction {
 
       private:
          set<string> parsed_templates;
          abi_generator abi_gen;
+         string abi_context;
+         abi_def& output;
+         string contract;
+         vector<string> actions;
 
       public:
 
-         generate_abi_action(bool verbose, bool opt_sfs, string abi_context,
-                             abi_def& output, const string& contract, const vector<string>& actions) {
-            
+         generate_abi_action(bool verbose, bool opt_sfs, string abi_context, abi_def& output)
+         : abi_context(abi_context), output(output) {
+
             abi_gen.set_output(output);
             abi_gen.set_verbose(verbose);
             abi_gen.set_abi_context(abi_context);
-            abi_gen.set_target_contract(contract, actions);
-          
+
             if(opt_sfs)
                abi_gen.enable_optimizaton(abi_generator::OPT_SINGLE_FIELD_STRUCT);
          }
@@ -436,7 +468,10 @@ namespace contento {
       protected:
          std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance& compiler_instance,
                                                         llvm::StringRef) override {
-            return llvm::make_unique<abi_generator_astconsumer>(compiler_instance, abi_gen);
+            compiler_instance.getPreprocessor().addPPCallbacks(
+               llvm::make_unique<abi_macro_handler>(compiler_instance, contract, actions, abi_context, output)
+            );
+            return llvm::make_unique<abi_generator_astconsumer>(compiler_instance, abi_gen, contract, actions);
          }
    };
 
@@ -0,0 +1,215 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <contento/abi_generator/abi_codec.hpp>
+#include <cstdlib>
+#include <iostream>
+
+using namespace contento::chain;
+
+namespace {
+
+   int failures = 0;
+
+   #define CHECK(cond) \
+      do { \
+         if( !(cond) ) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << std::endl; \
+            ++failures; \
+         } \
+      } while( 0 )
+
+   #define CHECK_THROWS(expr) \
+      do { \
+         bool thrown = false; \
+         try { expr; } catch( const abi_codec_exception& ) { thrown = true; } \
+         if( !thrown ) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": expected abi_codec_exception: " #expr << std::endl; \
+            ++failures; \
+         } \
+      } while( 0 )
+
+   abi_def test_abi() {
+      abi_def abi;
+      abi.types.emplace_back("account_name", "cosio::name");
+      abi.structs.emplace_back("record", "", vector<field_def>{
+         {"owner", "account_name"},
+         {"id",    "uint64"},
+         {"hash",  "cosio::checksum160"},
+      });
+      abi.structs.emplace_back("transfer", "record", vector<field_def>{
+         {"amount", "cosio::coin_amount"},
+         {"memo",   "cosio::bytes"},
+         {"flags",  "int8[]"},
+         {"ok",     "bool"},
+      });
+      abi.structs.emplace_back("node", "", vector<field_def>{
+         {"children", "node[]"},
+      });
+      abi.actions.emplace_back("transfer", "transfer");
+      abi.tables.emplace_back("records", "record", vector<field_name>{"id"});
+      return abi;
+   }
+
+   json test_transfer() {
+      return json{
+         {"owner",  "alice"},
+         {"id",     42},
+         {"hash",   "00112233445566778899aabbccddeeff00112233"},
+         {"amount", 1000},
+         {"memo",   "cafe"},
+         {"flags",  {-1, 0, 1}},
+         {"ok",     true},
+      };
+   }
+
+   void test_round_trip( const abi_codec& codec ) {
+      auto value = test_transfer();
+      auto data = codec.pack("transfer", value);
+      CHECK(codec.unpack("transfer", data) == value);
+      CHECK(codec.unpack(codec.get_action_type("transfer"), data.data(), data.size()) == value);
+
+      // typedefs resolve to the same program as the type they name
+      CHECK(codec.get_type("account_name") == codec.get_type("cosio::name"));
+   }
+
+   void test_wire_format( const abi_codec& codec ) {
+      auto data = codec.pack("transfer", test_transfer());
+      const vector<char> expected = [] {
+         vector<char> v;
+         v.push_back(5);                                 // transfer: 4 fields + base
+         v.push_back(3);                                 // record: 3 fields
+         v.push_back(5);
+         for( char c : string("alice") ) v.push_back(c);
+         v.push_back(42);
+         v.insert(v.end(), 7, 0);
+         v.push_back(20);                                // checksum160 size
+         for( int i = 0; i < 20; ++i ) v.push_back(char((i % 16) * 0x11));
+         v.push_back(char(0xe8)); v.push_back(3);        // 1000
+         v.insert(v.end(), 6, 0);
+         v.push_back(2); v.push_back(char(0xca)); v.push_back(char(0xfe));
+         v.push_back(3); v.push_back(char(-1)); v.push_back(0); v.push_back(1);
+         v.push_back(1);
+         return v;
+      }();
+      CHECK(data == expected);
+
+      // base struct fields are flattened into the derived object
+      auto value = codec.unpack("transfer", data);
+      CHECK(value.size() == 7);
+      CHECK(value.at("owner") == "alice");
+      CHECK(value.at("hash") == "00112233445566778899aabbccddeeff00112233");
+      CHECK(value.at("memo") == "cafe");
+   }
+
+   void test_hex( const abi_codec& codec ) {
+      auto value = test_transfer();
+      value["memo"] = "CAFE";
+      CHECK(codec.unpack("transfer", codec.pack("transfer", value)).at("memo") == "cafe");
+
+      value["memo"] = "caf";
+      CHECK_THROWS(codec.pack("transfer", value));
+      value["memo"] = "cafx";
+      CHECK_THROWS(codec.pack("transfer", value));
+
+      value = test_transfer();
+      value["hash"] = "0011";
+      CHECK_THROWS(codec.pack("transfer", value));
+   }
+
+   void test_find_field( const abi_codec& codec ) {
+      auto data = codec.pack("transfer", test_transfer());
+      auto type = codec.get_type("transfer");
+      abi_codec::row value;
+
+      // in the base struct
+      CHECK(codec.find_field(type, "id", data.data(), data.size(), value));
+      CHECK(value.size == 8 && value.data[0] == 42);
+
+      // after the base struct
+      CHECK(codec.find_field(type, "memo", data.data(), data.size(), value));
+      CHECK(value.size == 3 && value.data[0] == 2);
+
+      CHECK(!codec.find_field(type, "missing", data.data(), data.size(), value));
+      CHECK_THROWS(codec.find_field(codec.get_type("uint64"), "id", data.data(), data.size(), value));
+   }
+
+   void test_bad_input( const abi_codec& codec ) {
+      auto data = codec.pack("transfer", test_transfer());
+      auto type = codec.get_type("transfer");
+
+      for( size_t size = 0; size < data.size(); ++size )
+         CHECK_THROWS(codec.unpack(type, data.data(), size));
+
+      auto trailing = data;
+      trailing.push_back(0);
+      CHECK_THROWS(codec.unpack("transfer", trailing));
+
+      vector<json> rows;
+      CHECK_THROWS(codec.unpack_batch(type, {{trailing.data(), trailing.size()}}, rows));
+
+      abi_codec::row value;
+      CHECK_THROWS(codec.find_field(type, "ok", data.data(), data.size() - 1, value));
+
+      auto missing = test_transfer();
+      missing.erase("amount");
+      CHECK_THROWS(codec.pack("transfer", missing));
+   }
+
+   /// packs a chain of @p depth nodes, each holding the next as its only child
+   vector<char> nested_nodes( size_t depth ) {
+      vector<char> data;
+      for( size_t i = 1; i < depth; ++i ) {
+         data.push_back(1);
+         data.push_back(1);
+      }
+      data.push_back(1);
+      data.push_back(0);
+      return data;
+   }
+
+   json nested_json( size_t depth ) {
+      json value = {{"children", json::array()}};
+      for( size_t i = 1; i < depth; ++i )
+         value = {{"children", {value}}};
+      return value;
+   }
+
+   void test_depth_limit( const abi_codec& codec ) {
+      auto type = codec.get_type("node");
+      abi_codec::row value;
+
+      auto shallow = nested_nodes(10);
+      CHECK(codec.unpack("node", shallow) == nested_json(10));
+      CHECK(codec.pack("node", nested_json(10)) == shallow);
+      CHECK(codec.find_field(type, "children", shallow.data(), shallow.size(), value));
+
+      auto deep = nested_nodes(abi_serializer::max_recursion_depth);
+      CHECK_THROWS(codec.unpack("node", deep));
+      CHECK_THROWS(codec.find_field(type, "children", deep.data(), deep.size(), value));
+      CHECK_THROWS(codec.pack("node", nested_json(abi_serializer::max_recursion_depth)));
+
+      // far past the limit, this would overflow the stack without one
+      auto deeper = nested_nodes(1000000);
+      CHECK_THROWS(codec.unpack("node", deeper));
+   }
+
+}
+
+int main() {
+   abi_codec codec(test_abi());
+
+   test_round_trip(codec);
+   test_wire_format(codec);
+   test_hex(codec);
+   test_find_field(codec);
+   test_bad_input(codec);
+   test_depth_limit(codec);
+
+   if( failures ) {
+      std::cerr << failures << " check(s) failed" << std::endl;
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
@@ -13,7 +13,7 @@ using namespace contento::chain;
 
 //using mvo = fc::mutable_variant_object;
 
-std::unique_ptr<FrontendActionFactory> create_factory(bool verbose, bool opt_sfs, string abi_context, abi_def& output, const string& contract, const vector<string>& actions) {
+std::unique_ptr<FrontendActionFactory> create_factory(bool verbose, bool opt_sfs, string abi_context, abi_def& output) {
 
   struct abi_frontend_action_factory : public FrontendActionFactory {
 
@@ -21,45 +21,50 @@ std::unique_ptr<FrontendActionFactory> create_factory(bool verbose, bool opt_sfs
     bool                   opt_sfs;
     string                 abi_context;
     abi_def&               output;
-    const string&          contract;
-    const vector<string>&  actions;
 
     abi_frontend_action_factory(bool verbose, bool opt_sfs, string abi_context,
-      abi_def& output, const string& contract, const vector<string>& actions) : verbose(verbose),
-      abi_context(abi_context), output(output), contract(contract), actions(actions) {}
+      abi_def& output) : verbose(verbose), opt_sfs(opt_sfs),
+      abi_context(abi_context), output(output) {}
 
     clang::FrontendAction *create() override {
-      return new generate_abi_action(verbose, opt_sfs, abi_context, output, contract, actions);
+      return new generate_abi_action(verbose, opt_sfs, abi_context, output);
     }
 
   };
 
   return std::unique_ptr<FrontendActionFactory>(
-      new abi_frontend_action_factory(verbose, opt_sfs, abi_context, output, contract, actions)
+      new abi_frontend_action_factory(verbose, opt_sfs, abi_context, output)
   );
 }
 
-std::unique_ptr<FrontendActionFactory> create_find_macro_factory(string& contract, vector<string>& actions, string abi_context,abi_def& output) {
+// Precompiles a header for later runs, which cosiocc passes to clang with -include-pch. ClangTool
+// drops -o from the compile command, so the output file is set on the invocation instead.
+std::unique_ptr<FrontendActionFactory> create_pch_factory(string pch_file) {
 
-  struct abi_frontend_macro_action_factory : public FrontendActionFactory {
+  struct pch_action : public GeneratePCHAction {
+    string pch_file;
 
-    string&          contract;
-    vector<string>&  actions;
-    string           abi_context;
-    abi_def&               output;
+    pch_action(string pch_file) : pch_file(pch_file) {}
+
+    bool BeginInvocation(CompilerInstance& ci) override {
+      ci.getFrontendOpts().OutputFile = pch_file;
+      return GeneratePCHAction::BeginInvocation(ci);
+    }
+  };
 
-    abi_frontend_macro_action_factory (string& contract, vector<string>& actions,
-      string abi_context,abi_def& output) : contract(contract), actions(actions), abi_context(abi_context), output(output) {}
+  struct pch_frontend_action_factory : public FrontendActionFactory {
+
+    string pch_file;
+
+    pch_frontend_action_factory(string pch_file) : pch_file(pch_file) {}
 
     clang::FrontendAction *create() override {
-      return new find_contento_abi_macro_action(contract, actions, abi_context,output);
+      return new pch_action(pch_file);
     }
 
   };
 
-  return std::unique_ptr<FrontendActionFactory>(
-    new abi_frontend_macro_action_factory(contract, actions, abi_context,output)
-  );
+  return std::unique_ptr<FrontendActionFactory>(new pch_frontend_action_factory(pch_file));
 }
 
 static cl::OptionCategory abi_generator_category("ABI generator options");
@@ -84,23 +89,27 @@ static cl::opt<bool> abi_opt_sfs(
     cl::desc("Optimize single field struct"),
     cl::cat(abi_generator_category));
 
+static cl::opt<std::string> abi_generate_pch(
+    "generate-pch",
+    cl::desc("precompile the source, a header, into this file instead of generating an ABI"),
+    cl::cat(abi_generator_category));
+
 int main(int argc, const char **argv) { abi_def output; try {
    CommonOptionsParser op(argc, argv, abi_generator_category);
    ClangTool Tool(op.getCompilations(), op.getSourcePathList());
 
-   string contract;
-   vector<string> actions;
-   int result = Tool.run(create_find_macro_factory(contract, actions, abi_context,output).get());
+   if(!abi_generate_pch.empty()) {
+      return Tool.run(create_pch_factory(abi_generate_pch).get());
+   }
+
+   int result = Tool.run(create_factory(abi_verbose, abi_opt_sfs, abi_context, output).get());
    if(!result) {
-      result = Tool.run(create_factory(abi_verbose, abi_opt_sfs, abi_context, output, contract, actions).get());
-      if(!result) {
-         abi_serializer(output).validate();
-
-          json result;
-          output.to_json2(result);
-          std::ofstream os(abi_destination);
-          os << std::setw(4) << result << std::endl;
-      }
+      abi_serializer(output).validate();
+
+      json result;
+      output.to_json2(result);
+      std::ofstream os(abi_destination);
+      os << std::setw(4) << result << std::endl;
    }
    return result;
 } FC_CAPTURE_AND_LOG((output)); return -1; }
@@ -0,0 +1,507 @@
+//
+// cosio-run: executes a contract .wasm/.wast in the binaryen interpreter, on the in-memory chain of
+// contracts/native, for an action trace (see contracts/native/trace.hpp).
+//
+// Every action is reported with the number of wasm instructions it executed, which is what a node
+// meters through ExternalInterface::report(), the memory pages it grew, its host calls and wall time.
+// Each contract invocation gets a fresh module instance, as on chain.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+
+#include "support/command-line.h"
+#include "support/file.h"
+#include "wasm-interpreter.h"
+#include "wasm-io.h"
+
+#include "chain.hpp"
+#include "trace.hpp"
+
+using namespace wasm;
+using namespace cosio::native;
+
+namespace {
+
+struct RunStats {
+  uint64_t instructions = 0;
+  uint64_t gas = 0;                           // charged by code instrumented with --gas-metering
+  uint32_t pagesGrown = 0;
+  std::map<std::string, uint32_t> imports;   // host calls by function name
+};
+
+class ChainInterface;
+typedef Literal (*HostFunction)(ChainInterface& self, LiteralList& args);
+
+const std::unordered_map<std::string, HostFunction>& hostFunctions();
+
+//
+// Wires the imports of a contract to the chain, over the memory of a single module instance.
+//
+class ChainInterface final : public ModuleInstance::ExternalInterface {
+ public:
+  ChainInterface(chain& c, RunStats& stats) : c(c), stats(stats) {}
+
+  chain& c;
+  RunStats& stats;
+
+  void init(Module& wasm, ModuleInstance& instance) override {
+    memory.resize(wasm.memory.initial * Memory::kPageSize);
+    for (auto& segment : wasm.memory.segments) {
+      Address offset = ConstantExpressionRunner<TrivialGlobalManager>(instance.globals).visit(segment.offset).value.geti32();
+      if (offset + segment.data.size() > memory.size()) trap("memory segment out of bounds");
+      std::copy(segment.data.begin(), segment.data.end(), memory.begin() + offset);
+    }
+    table.resize(wasm.table.initial);
+    for (auto& segment : wasm.table.segments) {
+      Address offset = ConstantExpressionRunner<TrivialGlobalManager>(instance.globals).visit(segment.offset).value.geti32();
+      if (offset + segment.data.size() > table.size()) trap("table segment out of bounds");
+      std::copy(segment.data.begin(), segment.data.end(), table.begin() + offset);
+    }
+  }
+
+  void importGlobals(TrivialGlobalManager& globals, Module& wasm) override {
+    for (auto& import : wasm.imports) {
+      if (import->kind == ExternalKind::Global) {
+        Fatal() << "cosio-run: unsupported global import " << import->module.str << "." << import->base.str;
+      }
+    }
+  }
+
+  Literal callImport(Import* import, LiteralList& arguments) override {
+    auto& function = functions[import];
+    if (!function) {
+      auto iter = hostFunctions().find(import->base.str);
+      if (iter == hostFunctions().end()) {
+        throw contract_abort(std::string("unknown host function ") + import->base.str);
+      }
+      function = iter->second;
+    }
+    // metering is not a call to the chain
+    static const Name GAS_CHARGE("gas_charge");
+    if (import->base != GAS_CHARGE) {
+      stats.imports[import->base.str]++;
+      c.host_call();
+    }
+    return function(*this, arguments);
+  }
+
+  Literal callTable(Index index, LiteralList& arguments, WasmType result, ModuleInstance& instance) override {
+    if (index >= table.size()) trap("callTable overflow");
+    auto* func = instance.wasm.getFunctionOrNull(table[index]);
+    if (!func) trap("uninitialized table element");
+    if (func->params.size() != arguments.size()) trap("callIndirect: bad # of arguments");
+    for (size_t i = 0; i < func->params.size(); i++) {
+      if (func->params[i] != arguments[i].type) trap("callIndirect: bad argument type");
+    }
+    if (func->result != result) trap("callIndirect: bad result type");
+    return instance.callFunctionInternal(func->name, arguments);
+  }
+
+  void growMemory(Address oldSize, Address newSize) override {
+    memory.resize(newSize);
+    stats.pagesGrown += (newSize - oldSize) / Memory::kPageSize;
+  }
+
+  void trap(const char* why) override {
+    throw contract_abort(std::string("wasm trap: ") + why);
+  }
+
+  void report(InfoType type, uintptr_t, uintptr_t, uintptr_t, uintptr_t) override {
+    if (type == InfoTypeRunExpression) stats.instructions++;
+  }
+
+  // the interpreter checks addresses against the memory size before loads and stores
+  template<typename T> T get(Address addr) { T v; std::memcpy(&v, &memory[addr], sizeof(T)); return v; }
+  template<typename T> void set(Address addr, T v) { std::memcpy(&memory[addr], &v, sizeof(T)); }
+
+  int8_t load8s(Address addr) override { return get<int8_t>(addr); }
+  uint8_t load8u(Address addr) override { return get<uint8_t>(addr); }
+  int16_t load16s(Address addr) override { return get<int16_t>(addr); }
+  uint16_t load16u(Address addr) override { return get<uint16_t>(addr); }
+  int32_t load32s(Address addr) override { return get<int32_t>(addr); }
+  uint32_t load32u(Address addr) override { return get<uint32_t>(addr); }
+  int64_t load64s(Address addr) override { return get<int64_t>(addr); }
+  uint64_t load64u(Address addr) override { return get<uint64_t>(addr); }
+
+  void store8(Address addr, int8_t value) override { set<int8_t>(addr, value); }
+  void store16(Address addr, int16_t value) override { set<int16_t>(addr, value); }
+  void store32(Address addr, int32_t value) override { set<int32_t>(addr, value); }
+  void store64(Address addr, int64_t value) override { set<int64_t>(addr, value); }
+
+  // access to contract memory from host functions; out of bounds accesses abort the contract.
+
+  const char* span(uint32_t ptr, int32_t size) {
+    if (size < 0 || uint64_t(ptr) + uint32_t(size) > memory.size()) {
+      throw contract_abort("host function argument out of bounds");
+    }
+    return memory.data() + ptr;
+  }
+
+  std::string readString(const Literal& ptr, const Literal& size) {
+    auto s = std::max(size.geti32(), 0);
+    return std::string(span(ptr.geti32(), s), s);
+  }
+
+  bytes readBytes(const Literal& ptr, const Literal& size) {
+    auto s = std::max(size.geti32(), 0);
+    auto p = span(ptr.geti32(), s);
+    return bytes(p, p + s);
+  }
+
+  uint32_t readU32(uint32_t ptr) {
+    uint32_t v;
+    std::memcpy(&v, span(ptr, 4), 4);
+    return v;
+  }
+
+  uint64_t readU64(uint32_t ptr) {
+    uint64_t v;
+    std::memcpy(&v, span(ptr, 8), 8);
+    return v;
+  }
+
+  // host readers copy as much as fits if size is positive, and return the data size otherwise.
+  Literal writeOut(const char* data, size_t dataSize, const Literal& ptr, const Literal& size) {
+    int32_t s = size.geti32();
+    if (s <= 0) return Literal(int32_t(dataSize));
+    int32_t n = std::min(s, int32_t(dataSize));
+    std::memcpy(const_cast<char*>(span(ptr.geti32(), n)), data, n);
+    return Literal(n);
+  }
+
+  Literal writeOut(const std::string& s, const Literal& ptr, const Literal& size) {
+    return writeOut(s.data(), s.size(), ptr, size);
+  }
+
+  Literal writeRecord(const bytes* record, const Literal& ptr, const Literal& size) {
+    return record ? writeOut(record->data(), record->size(), ptr, size) : Literal(int32_t(0));
+  }
+
+  // (char** strings, int strings_len, int* sizes, int sizes_len) arrays, with lengths in bytes
+  std::vector<std::string> readStrings(LiteralList& a, size_t i) {
+    uint32_t count = uint32_t(std::max(a[i + 1].geti32(), 0)) / 4;
+    c.check(count == uint32_t(std::max(a[i + 3].geti32(), 0)) / 4, "illegal parameters");
+    std::vector<std::string> strings;
+    for (uint32_t k = 0; k < count; k++) {
+      uint32_t str = readU32(a[i].geti32() + 4 * k);
+      int32_t len = int32_t(readU32(a[i + 2].geti32() + 4 * k));
+      strings.push_back(readString(Literal(int32_t(str)), Literal(len)));
+    }
+    return strings;
+  }
+
+ private:
+  std::vector<char> memory;
+  std::vector<Name> table;
+  std::unordered_map<Import*, HostFunction> functions;
+};
+
+//
+// system.h
+//
+const std::unordered_map<std::string, HostFunction>& hostFunctions() {
+  static const std::unordered_map<std::string, HostFunction> functions = {
+    {"current_block_number", [](ChainInterface& self, LiteralList& a) {
+      return Literal(int64_t(self.c.block_number()));
+    }},
+    {"current_timestamp", [](ChainInterface& self, LiteralList& a) {
+      return Literal(int64_t(self.c.timestamp()));
+    }},
+    {"current_block_producer", [](ChainInterface& self, LiteralList& a) {
+      return self.writeOut(self.c.block_producer(), a[0], a[1]);
+    }},
+    {"get_block_producers", [](ChainInterface& self, LiteralList& a) {
+      return self.writeOut(self.c.block_producers(), a[0], a[1]);
+    }},
+    {"sha256", [](ChainInterface& self, LiteralList& a) {
+      auto data = self.readBytes(a[0], a[1]);
+      char digest[32];
+      sha256(data.data(), data.size(), digest);
+      return self.writeOut(digest, sizeof(digest), a[2], a[3]);
+    }},
+    {"print_str", [](ChainInterface& self, LiteralList& a) {
+      auto s = self.readString(a[0], a[1]);
+      self.c.print(s.data(), s.size());
+      return Literal();
+    }},
+    {"print_int", [](ChainInterface& self, LiteralList& a) {
+      auto s = std::to_string(a[0].geti64());
+      self.c.print(s.data(), s.size());
+      return Literal();
+    }},
+    {"print_uint", [](ChainInterface& self, LiteralList& a) {
+      auto s = std::to_string(uint64_t(a[0].geti64()));
+      self.c.print(s.data(), s.size());
+      return Literal();
+    }},
+    {"require_auth", [](ChainInterface& self, LiteralList& a) {
+      self.c.require_auth(self.readString(a[0], a[1]));
+      return Literal();
+    }},
+    {"get_user_balance", [](ChainInterface& self, LiteralList& a) {
+      return Literal(int64_t(self.c.user_balance(self.readString(a[0], a[1]))));
+    }},
+    {"user_exist", [](ChainInterface& self, LiteralList& a) {
+      return Literal(int32_t(self.c.user_exists(self.readString(a[0], a[1])) ? 1 : 0));
+    }},
+    {"get_contract_balance", [](ChainInterface& self, LiteralList& a) {
+      return Literal(int64_t(self.c.contract_balance(self.readString(a[0], a[1]), self.readString(a[2], a[3]))));
+    }},
+    {"table_get_record", [](ChainInterface& self, LiteralList& a) {
+      auto record = self.c.get_record(self.readString(a[0], a[1]), self.readBytes(a[2], a[3]));
+      return self.writeRecord(record, a[4], a[5]);
+    }},
+    {"table_new_record", [](ChainInterface& self, LiteralList& a) {
+      self.c.new_record(self.readString(a[0], a[1]), self.readBytes(a[2], a[3]));
+      return Literal();
+    }},
+    {"table_update_record", [](ChainInterface& self, LiteralList& a) {
+      self.c.update_record(self.readString(a[0], a[1]), self.readBytes(a[2], a[3]), self.readBytes(a[4], a[5]));
+      return Literal();
+    }},
+    {"table_delete_record", [](ChainInterface& self, LiteralList& a) {
+      self.c.delete_record(self.readString(a[0], a[1]), self.readBytes(a[2], a[3]));
+      return Literal();
+    }},
+    {"table_get_record_ex", [](ChainInterface& self, LiteralList& a) {
+      auto record = self.c.get_record_ex(self.readString(a[0], a[1]), self.readString(a[2], a[3]),
+                                         self.readString(a[4], a[5]), self.readBytes(a[6], a[7]));
+      return self.writeRecord(record, a[8], a[9]);
+    }},
+    {"cos_assert", [](ChainInterface& self, LiteralList& a) {
+      if (!a[0].geti32()) self.c.check(false, self.readString(a[1], a[2]));
+      return Literal();
+    }},
+    {"abort", [](ChainInterface& self, LiteralList& a) -> Literal {
+      throw contract_abort("abort() called");
+    }},
+    {"gas_charge", [](ChainInterface& self, LiteralList& a) {
+      self.stats.gas += uint32_t(a[0].geti32());
+      return Literal();
+    }},
+    {"read_contract_op_params", [](ChainInterface& self, LiteralList& a) {
+      const auto& params = self.c.current().params;
+      return self.writeOut(params.data(), params.size(), a[0], a[1]);
+    }},
+    {"read_contract_sender_value", [](ChainInterface& self, LiteralList& a) {
+      return Literal(int64_t(self.c.current().value));
+    }},
+    {"read_contract_name", [](ChainInterface& self, LiteralList& a) {
+      return self.writeOut(self.c.current().contract->name, a[0], a[1]);
+    }},
+    {"read_contract_method", [](ChainInterface& self, LiteralList& a) {
+      return self.writeOut(self.c.current().method, a[0], a[1]);
+    }},
+    {"read_contract_owner", [](ChainInterface& self, LiteralList& a) {
+      return self.writeOut(self.c.current().contract->owner, a[0], a[1]);
+    }},
+    {"read_contract_caller", [](ChainInterface& self, LiteralList& a) {
+      return self.writeOut(self.c.current().caller, a[0], a[1]);
+    }},
+    {"contract_called_by_user", [](ChainInterface& self, LiteralList& a) {
+      return Literal(int32_t(self.c.current().calling == nullptr ? 1 : 0));
+    }},
+    {"read_calling_contract_owner", [](ChainInterface& self, LiteralList& a) {
+      auto calling = self.c.current().calling;
+      return calling ? self.writeOut(calling->owner, a[0], a[1]) : Literal(int32_t(0));
+    }},
+    {"read_calling_contract_name", [](ChainInterface& self, LiteralList& a) {
+      auto calling = self.c.current().calling;
+      return calling ? self.writeOut(calling->name, a[0], a[1]) : Literal(int32_t(0));
+    }},
+    {"contract_call", [](ChainInterface& self, LiteralList& a) {
+      self.c.call(self.readString(a[0], a[1]), self.readString(a[2], a[3]), self.readString(a[4], a[5]),
+                  self.readBytes(a[6], a[7]), uint64_t(a[8].geti64()));
+      return Literal();
+    }},
+    {"transfer_to_user", [](ChainInterface& self, LiteralList& a) {
+      self.c.transfer_to_user(self.readString(a[0], a[1]), uint64_t(a[2].geti64()), false);
+      return Literal();
+    }},
+    {"transfer_to_user_vest", [](ChainInterface& self, LiteralList& a) {
+      self.c.transfer_to_user(self.readString(a[0], a[1]), uint64_t(a[2].geti64()), true);
+      return Literal();
+    }},
+    {"transfer_to_contract", [](ChainInterface& self, LiteralList& a) {
+      self.c.transfer_to_contract(self.readString(a[0], a[1]), self.readString(a[2], a[3]), uint64_t(a[4].geti64()));
+      return Literal();
+    }},
+    {"get_reputation_admin", [](ChainInterface& self, LiteralList& a) {
+      return self.writeOut(self.c.reputation_admin(), a[0], a[1]);
+    }},
+    {"set_reputation_admin", [](ChainInterface& self, LiteralList& a) {
+      self.c.set_reputation_admin(self.readString(a[0], a[1]));
+      return Literal();
+    }},
+    {"set_reputation", [](ChainInterface& self, LiteralList& a) {
+      auto names = self.readStrings(a, 0);
+      self.c.check(names.size() == uint32_t(std::max(a[5].geti32(), 0)) / 4, "illegal parameters");
+      for (size_t i = 0; i < names.size(); i++) {
+        self.c.set_reputation(names[i], int32_t(self.readU32(a[4].geti32() + 4 * i)));
+      }
+      return Literal(int32_t(0));
+    }},
+    {"set_copyright_admin", [](ChainInterface& self, LiteralList& a) {
+      self.c.set_copyright_admin(self.readString(a[0], a[1]));
+      return Literal();
+    }},
+    {"set_copyright", [](ChainInterface& self, LiteralList& a) {
+      uint32_t count = uint32_t(std::max(a[1].geti32(), 0)) / 8;
+      self.c.check(count == uint32_t(std::max(a[3].geti32(), 0)) / 4, "illegal parameters");
+      for (uint32_t i = 0; i < count; i++) {
+        self.c.set_copyright(self.readU64(a[0].geti32() + 8 * i), int32_t(self.readU32(a[2].geti32() + 4 * i)));
+      }
+      return Literal(int32_t(0));
+    }},
+    {"set_freeze", [](ChainInterface& self, LiteralList& a) {
+      auto names = self.readStrings(a, 0);
+      for (auto& name : names) {
+        self.c.set_freeze(name, a[4].geti32() != 0);
+      }
+      return Literal(int32_t(0));
+    }},
+  };
+  return functions;
+}
+
+struct MethodStats {
+  size_t calls = 0;
+  size_t aborts = 0;
+  uint64_t instructions = 0;
+  uint64_t gas = 0;
+  uint32_t maxPagesGrown = 0;
+  double micros = 0;
+};
+
+} // anonymous namespace
+
+int main(int argc, const char* argv[]) {
+  std::vector<std::string> files;
+  std::string owner = "initminer", contract;
+  size_t repeat = 1;
+  bool summary = false, showPrint = false;
+
+  Options options("cosio-run", "Run an action trace on a contract with an in-memory chain, and meter every action");
+  options
+      .add("--owner", "", "Owner account of the contract (default initminer)",
+           Options::Arguments::One,
+           [&owner](Options*, const std::string& argument) { owner = argument; })
+      .add("--contract", "", "Name of the contract (default: the wasm file name)",
+           Options::Arguments::One,
+           [&contract](Options*, const std::string& argument) { contract = argument; })
+      .add("--repeat", "", "Run the actions of the trace this many times (default 1)",
+           Options::Arguments::One,
+           [&repeat](Options*, const std::string& argument) { repeat = std::stoul(argument); })
+      .add("--summary", "", "Report per method only, not per action",
+           Options::Arguments::Zero,
+           [&summary](Options*, const std::string&) { summary = true; })
+      .add("--print", "", "Show what the contract prints",
+           Options::Arguments::Zero,
+           [&showPrint](Options*, const std::string&) { showPrint = true; })
+      .add_positional("CONTRACT.wasm CONTRACT.abi TRACE", Options::Arguments::N,
+                      [&files](Options*, const std::string& argument) { files.push_back(argument); });
+  options.parse(argc, argv);
+  if (files.size() != 3) {
+    Fatal() << "expected a contract .wasm or .wast, its ABI and a trace";
+  }
+  if (contract.empty()) {
+    auto base = files[0].substr(files[0].find_last_of('/') + 1);
+    contract = base.substr(0, base.find('.'));
+  }
+
+  Module wasm;
+  try {
+    ModuleReader().read(files[0], wasm);
+  } catch (ParseException& p) {
+    p.dump(std::cerr);
+    Fatal() << "error in parsing input";
+  }
+
+  chain c;
+  RunStats stats;
+  std::vector<trace_step> steps;
+  try {
+    auto entry = [&c, &stats, &wasm]() {
+      ChainInterface interface(c, stats);
+      ModuleInstance instance(wasm, &interface);
+      return uint32_t(instance.callExport(Name("apply")).geti32());
+    };
+    auto& def = c.deploy(owner, contract, load_abi(files[1]), entry);
+    steps = load_trace(files[2], *def.abi);
+  } catch (const std::exception& e) {
+    Fatal() << e.what();
+  }
+
+  std::map<std::string, MethodStats> methods;
+  RunStats total;
+  using clock = std::chrono::steady_clock;
+
+  for (size_t round = 0; round < repeat; round++) {
+    for (const auto& s : steps) {
+      if (s.kind == trace_step::create_user) {
+        if (round == 0) c.create_user(s.name, s.args[0]);
+        continue;
+      } else if (s.kind == trace_step::set_block) {
+        c.set_block(s.args[0], s.args[1]);
+        continue;
+      }
+      const auto& a = s.action;
+      stats = RunStats();
+      std::string error;
+      auto start = clock::now();
+      try {
+        c.push_action(a.caller, owner, contract, a.method, a.params, a.value);
+      } catch (const contract_abort& e) {
+        error = e.what();
+      }
+      double us = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+
+      auto& m = methods[a.method];
+      m.calls++;
+      m.aborts += !error.empty();
+      m.instructions += stats.instructions;
+      m.gas += stats.gas;
+      m.maxPagesGrown = std::max(m.maxPagesGrown, stats.pagesGrown);
+      m.micros += us;
+      total.instructions += stats.instructions;
+      for (auto& i : stats.imports) total.imports[i.first] += i.second;
+
+      if (!summary) {
+        const auto& st = c.last_stats();
+        std::cout << "line " << a.line << ": " << a.method
+                  << " instructions=" << stats.instructions
+                  << " gas=" << stats.gas
+                  << " pages_grown=" << stats.pagesGrown
+                  << " host_calls=" << st.host_calls
+                  << " table_reads=" << st.table_reads
+                  << " table_writes=" << st.table_writes
+                  << " contract_calls=" << st.contract_calls
+                  << " time=" << us << "us";
+        if (!error.empty()) std::cout << " ABORTED: " << error;
+        std::cout << '\n';
+      }
+      if (showPrint && !c.console().empty()) std::cout << c.console() << '\n';
+    }
+  }
+
+  std::cout << "methods:\n";
+  for (auto& kv : methods) {
+    auto& m = kv.second;
+    std::cout << "  " << kv.first << ": " << m.calls << " calls, " << m.aborts << " aborted"
+              << ", mean " << m.instructions / m.calls << " instructions"
+              << ", mean " << m.gas / m.calls << " gas"
+              << ", max " << m.maxPagesGrown << " pages grown"
+              << ", mean " << m.micros / m.calls << "us\n";
+  }
+  std::cout << "host calls:\n";
+  std::vector<std::pair<uint32_t, std::string>> imports;
+  for (auto& i : total.imports) imports.emplace_back(i.second, i.first);
+  std::sort(imports.rbegin(), imports.rend());
+  for (auto& i : imports) {
+    std::cout << "  " << i.second << ": " << i.first << '\n';
+  }
+  return 0;
+}
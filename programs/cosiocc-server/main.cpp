@@ -0,0 +1,397 @@
+//
+// cosiocc-server: runs cosiocc builds on behalf of clients, over a Unix socket.
+//
+// Started by `cosiocc --daemon SOCKET`, which warms the build cache first (see build_pch in
+// cosiocc), then serves every cosiocc run with COSIOCC_SERVER=SOCKET in its environment, forwarded
+// here by `cosiocc-server --connect`. All clients share one cache and the precompiled headers in it,
+// and at most --jobs builds run at a time however many IDE and CI processes call in; the others wait
+// in the queue.
+//
+// A request is a JSON object, sent by the client before it shuts down its end of the connection:
+//
+//      {"cwd": "/path", "args": ["-o", "c.wast", "c.cpp"], "env": ["NAME=value", ...]}
+//
+// and the reply, sent once the build is done:
+//
+//      {"status": 0, "stdout": "...", "stderr": "..."}
+//
+// Outputs are written by cosiocc to the paths in args, relative to cwd, as if it ran in the client.
+// The socket is created accessible to its owner only, since requests run with the owner's rights.
+//
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+extern char** environ;
+
+using json = nlohmann::json;
+
+namespace {
+
+    const char* server_env = "COSIOCC_SERVER";
+
+    // how long a socket read or write of a client may block; builds themselves are not limited
+    const int client_timeout_seconds = 30;
+
+    void usage() {
+        std::cerr << "usage: cosiocc-server --listen SOCKET [--jobs N] COSIOCC" << std::endl
+                  << "       cosiocc-server --connect SOCKET [cosiocc arguments...]" << std::endl;
+    }
+
+    sockaddr_un socket_address(const std::string& path) {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            throw std::runtime_error("socket path too long: " + path);
+        }
+        strcpy(addr.sun_path, path.c_str());
+        return addr;
+    }
+
+    std::string read_all(int fd) {
+        std::string data;
+        char buf[65536];
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) != 0) {
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    throw std::runtime_error("read: timed out");
+                }
+                throw std::runtime_error(std::string("read: ") + strerror(errno));
+            }
+            data.append(buf, n);
+        }
+        return data;
+    }
+
+    void write_all(int fd, const std::string& data) {
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = write(fd, data.data() + done, data.size() - done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("write: ") + strerror(errno));
+            }
+            done += n;
+        }
+    }
+
+    /**
+     * @brief write @p message and errno to stderr, from a child forked by a multithreaded process.
+     *
+     * Only async-signal-safe calls are allowed there: another thread may have held the lock of
+     * std::cerr, or of the allocator, at the time of the fork. So the message is formatted before
+     * the fork, and errno is printed as a number.
+     */
+    void write_child_error(const std::string& message) {
+        char buf[16];
+        char* end = buf + sizeof(buf);
+        char* p = end;
+        *--p = '\n';
+        int code = errno;
+        do {
+            *--p = char('0' + code % 10);
+            code /= 10;
+        } while (code && p > buf);
+        ssize_t rc = write(2, message.data(), message.size());
+        rc = write(2, p, end - p);
+        (void)rc;
+    }
+
+    /**
+     * @brief run cosiocc for one request, and collect its exit status and output.
+     */
+    json run_build(const std::string& cosiocc, const json& request) {
+        std::vector<std::string> args{cosiocc}, env;
+        for (auto& a : request.at("args")) {
+            args.push_back(a.get<std::string>());
+        }
+        for (auto& e : request.at("env")) {
+            auto var = e.get<std::string>();
+            // the build runs here, it must not be forwarded back
+            if (var.compare(0, strlen(server_env) + 1, std::string(server_env) + "=") != 0) {
+                env.push_back(var);
+            }
+        }
+        auto cwd = request.at("cwd").get<std::string>();
+
+        std::vector<char*> argv, envp;
+        for (auto& a : args) {
+            argv.push_back(&a[0]);
+        }
+        argv.push_back(nullptr);
+        for (auto& e : env) {
+            envp.push_back(&e[0]);
+        }
+        envp.push_back(nullptr);
+
+        // the child may not allocate, see write_child_error
+        auto chdir_error = "cannot enter " + cwd + ": errno ";
+        auto exec_error = "cannot run " + args[0] + ": errno ";
+
+        int out[2], err[2];
+        if (pipe2(out, O_CLOEXEC) || pipe2(err, O_CLOEXEC)) {
+            throw std::runtime_error(std::string("pipe: ") + strerror(errno));
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error(std::string("fork: ") + strerror(errno));
+        }
+        if (pid == 0) {
+            dup2(out[1], 1);
+            dup2(err[1], 2);
+            close(out[0]); close(out[1]);
+            close(err[0]); close(err[1]);
+            if (chdir(cwd.c_str())) {
+                write_child_error(chdir_error);
+                _exit(127);
+            }
+            execve(argv[0], argv.data(), envp.data());
+            write_child_error(exec_error);
+            _exit(127);
+        }
+        close(out[1]);
+        close(err[1]);
+
+        // both pipes are drained together, so that neither fills up and stalls the build
+        std::string output[2];
+        pollfd fds[2] = {{out[0], POLLIN, 0}, {err[0], POLLIN, 0}};
+        int open_fds = 2;
+        while (open_fds) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            for (int i = 0; i < 2; i++) {
+                if (fds[i].fd < 0 || !fds[i].revents) {
+                    continue;
+                }
+                char buf[65536];
+                ssize_t n = read(fds[i].fd, buf, sizeof(buf));
+                if (n > 0) {
+                    output[i].append(buf, n);
+                } else if (n == 0 || errno != EINTR) {
+                    close(fds[i].fd);
+                    fds[i].fd = -1;
+                    open_fds--;
+                }
+            }
+        }
+
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+        }
+        json reply;
+        reply["status"] = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        reply["stdout"] = output[0];
+        reply["stderr"] = output[1];
+        return reply;
+    }
+
+    /**
+     * @brief a queue of accepted connections, served by a fixed number of workers.
+     *
+     * The queue is bounded too: once it is full, the server stops accepting, and new clients wait in
+     * the listen backlog of the socket rather than in memory here.
+     */
+    class connection_queue {
+    public:
+        explicit connection_queue(size_t capacity) : capacity(capacity) {}
+
+        void push(int fd) {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [this] { return fds.size() < capacity; });
+            fds.push_back(fd);
+            not_empty.notify_one();
+        }
+
+        int pop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [this] { return !fds.empty(); });
+            int fd = fds.front();
+            fds.pop_front();
+            not_full.notify_one();
+            return fd;
+        }
+
+    private:
+        size_t capacity;
+        std::deque<int> fds;
+        std::mutex mutex;
+        std::condition_variable not_empty, not_full;
+    };
+
+    void serve(int fd, const std::string& cosiocc) {
+        json reply;
+        try {
+            reply = run_build(cosiocc, json::parse(read_all(fd)));
+        } catch (const std::exception& e) {
+            reply["status"] = 1;
+            reply["stdout"] = "";
+            reply["stderr"] = std::string("cosiocc-server: ") + e.what() + "\n";
+        }
+        std::string text;
+        try {
+            text = reply.dump();
+        } catch (const std::exception& e) {
+            // output that is not UTF-8 cannot be sent as JSON, the status still can
+            reply["stdout"] = "";
+            reply["stderr"] = std::string("cosiocc-server: cannot forward the build output: ") + e.what() + "\n";
+            text = reply.dump();
+        }
+        try {
+            write_all(fd, text);
+        } catch (const std::exception& e) {
+            // the client went away, nothing left to tell it
+        }
+        close(fd);
+    }
+
+    int listen_on(const std::string& path, const std::string& cosiocc, size_t jobs) {
+        auto addr = socket_address(path);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            std::cerr << "socket: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        // a socket file left by a server that is gone is replaced, a live one is not
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) {
+            std::cerr << "a server is already listening on " << path << std::endl;
+            return 1;
+        }
+        unlink(path.c_str());
+        auto mask = umask(077);
+        int rc = bind(fd, (sockaddr*)&addr, sizeof(addr));
+        umask(mask);
+        if (rc || listen(fd, 128)) {
+            std::cerr << path << ": " << strerror(errno) << std::endl;
+            return 1;
+        }
+        std::cerr << "cosiocc-server: listening on " << path << ", " << jobs << " jobs" << std::endl;
+
+        connection_queue queue(jobs * 4);
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < jobs; i++) {
+            workers.emplace_back([&] {
+                for (;;) {
+                    serve(queue.pop(), cosiocc);
+                }
+            });
+        }
+        for (;;) {
+            int client = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                std::cerr << "accept: " << strerror(errno) << std::endl;
+                return 1;
+            }
+            // a client that connects but never finishes its request, or never reads the reply,
+            // would otherwise hold a worker forever
+            timeval timeout = {client_timeout_seconds, 0};
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            queue.push(client);
+        }
+    }
+
+    int connect_to(const std::string& path, const std::vector<std::string>& args) {
+        auto addr = socket_address(path);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr))) {
+            std::cerr << "cannot connect to cosiocc server at " << path << ": " << strerror(errno) << std::endl;
+            return 1;
+        }
+        char cwd[PATH_MAX];
+        if (!getcwd(cwd, sizeof(cwd))) {
+            std::cerr << "getcwd: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        json request;
+        request["cwd"] = cwd;
+        request["args"] = args;
+        request["env"] = json::array();
+        for (char** e = environ; *e; e++) {
+            request["env"].push_back(*e);
+        }
+
+        json reply;
+        try {
+            write_all(fd, request.dump());
+            shutdown(fd, SHUT_WR);
+            reply = json::parse(read_all(fd));
+        } catch (const std::exception& e) {
+            std::cerr << "cosiocc server at " << path << ": " << e.what() << std::endl;
+            return 1;
+        }
+        close(fd);
+        std::cout << reply.at("stdout").get<std::string>() << std::flush;
+        std::cerr << reply.at("stderr").get<std::string>() << std::flush;
+        return reply.at("status").get<int>();
+    }
+
+}
+
+int main(int argc, char** argv) {
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.size() >= 2 && args[0] == "--connect") {
+        return connect_to(args[1], std::vector<std::string>(args.begin() + 2, args.end()));
+    }
+
+    std::string path, cosiocc;
+    size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < args.size(); i++) {
+        const auto& a = args[i];
+        bool has_value = i + 1 < args.size();
+        if (a == "--listen" && has_value) {
+            path = args[++i];
+        } else if ((a == "--jobs" || a == "-j") && has_value) {
+            jobs = std::max<size_t>(1, std::stoul(args[++i]));
+        } else if (a == "-h" || a == "--help") {
+            usage();
+            return 0;
+        } else if (a[0] == '-' || !cosiocc.empty()) {
+            usage();
+            return 1;
+        } else {
+            cosiocc = a;
+        }
+    }
+    if (path.empty() || cosiocc.empty()) {
+        usage();
+        return 1;
+    }
+    return listen_on(path, cosiocc, jobs);
+}
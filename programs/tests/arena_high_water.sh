@@ -0,0 +1,40 @@
+#!/bin/bash
+#
+# Checks that cosiocc --arena-high-water reaches the built contract, rather than the
+# weak 1 MB default of cosiolib_arena.
+#
+# usage: arena_high_water.sh path/to/cosiocc
+#
+
+set -e
+cosiocc=$1
+dir=`mktemp -d`
+trap "rm -rf $dir" EXIT
+
+# a contract that allocates, so that the high-water mark is used
+cat > $dir/arena.cpp <<'CPP'
+#include <cosiolib/contract.hpp>
+#include <cosiolib/print.hpp>
+
+class arena : public cosio::contract {
+public:
+    using cosio::contract::contract;
+
+    void fill(uint32_t n) {
+        std::string s(n, 'x');
+        cosio::print(s);
+    }
+};
+
+COSIO_ABI(arena, (fill))
+CPP
+
+# 0x12345: after LTO the mark is either an i32.const in the code, or these bytes
+# of a data segment, which the text form prints as E#\01\00
+$cosiocc --no-cache --arena --arena-high-water 74565 -o $dir/arena.wast $dir/arena.cpp
+if grep -qF 'i32.const 74565)' $dir/arena.wast || grep -qF 'E#\01\00' $dir/arena.wast; then
+    echo "ok: the arena high-water mark is 74565"
+else
+    echo "FAIL: --arena-high-water 74565 is not in the contract"
+    exit 1
+fi
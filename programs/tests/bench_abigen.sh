@@ -0,0 +1,66 @@
+#!/bin/bash
+#
+# Times ABI generation for a synthetic contract with thousands of structs, to measure the
+# struct, typedef and action lookups of libraries/abi_generator.
+#
+# usage: bench_abigen.sh path/to/cosiocc [actions [structs per action]]
+#
+# Every action takes its own struct, which holds that many structs of its own, each with a
+# typedef'd id, a string and an array of the action's first struct. The defaults, 200 actions of
+# 15 structs, give 3200 structs; COSIO_ABI takes at most 256 actions.
+#
+
+set -e
+cosiocc=$1
+actions=${2:-200}
+per_action=${3:-15}
+dir=`mktemp -d`
+trap "rm -rf $dir" EXIT
+
+{
+    echo '#include <cosiolib/contract.hpp>'
+    echo
+    for (( a = 0; a < actions; ++a )); do
+        fields=""
+        for (( s = 0; s < per_action; ++s )); do
+            echo "typedef uint64_t id_${a}_${s};"
+            echo "struct part_${a}_${s} {"
+            echo "    id_${a}_${s} id;"
+            echo "    std::string name;"
+            if (( s > 0 )); then
+                echo "    std::vector<part_${a}_0> first;"
+                echo "    COSIO_SERIALIZE(part_${a}_${s}, (id)(name)(first))"
+            else
+                echo "    COSIO_SERIALIZE(part_${a}_${s}, (id)(name))"
+            fi
+            echo "};"
+            fields="$fields(p$s)"
+        done
+        echo "struct args_${a} {"
+        for (( s = 0; s < per_action; ++s )); do
+            echo "    part_${a}_${s} p$s;"
+        done
+        echo "    COSIO_SERIALIZE(args_${a}, $fields)"
+        echo "};"
+        echo
+    done
+
+    echo "class bench : public cosio::contract {"
+    echo "public:"
+    echo "    using cosio::contract::contract;"
+    for (( a = 0; a < actions; ++a )); do
+        echo "    void act${a}(const args_${a}& args) {}"
+    done
+    echo "};"
+    echo
+    echo -n "COSIO_ABI(bench, "
+    for (( a = 0; a < actions; ++a )); do
+        echo -n "(act${a})"
+    done
+    echo ")"
+} > $dir/bench.cpp
+
+echo "$actions actions, $((actions * (per_action + 1))) structs"
+# the precompiled header is built by the first run; time the second
+$cosiocc -g $dir/bench.abi $dir/bench.cpp > /dev/null
+time $cosiocc -g $dir/bench.abi $dir/bench.cpp